@@ -0,0 +1,175 @@
+#include "arena.hh"
+
+#include <algorithm>
+#include <cstdlib> // For malloc, free
+#include <cstring> // For memcpy
+#include <new>     // For std::nothrow
+
+namespace {
+
+// WHY round capacities up? Images of similar size then share one capacity instead of growing
+// the arena by a few bytes (and reallocating it) each time.
+constexpr std::size_t arena_granularity{std::size_t{1} << 20};
+
+std::atomic<std::size_t> arena_count{0};
+std::atomic<std::size_t> largest_arena_bytes{0};
+std::atomic<std::size_t> total_arena_bytes{0};
+
+// The arena of this thread's bump session, or null outside one.
+thread_local buffer_arena *bump_arena{nullptr};
+
+// Every block from arena_malloc() starts with this header.
+// WHY 16 bytes? Keeps the block itself aligned as malloc() would align it.
+struct alignas(16) block_header {
+    std::size_t size;
+    bool in_arena;
+};
+
+constexpr std::size_t round_up(const std::size_t value, const std::size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Arena bytes a block of `size` takes, header included.
+constexpr std::size_t block_footprint(const std::size_t size)
+{
+    return sizeof(block_header) + round_up(size, sizeof(block_header));
+}
+
+block_header *header_of(void *block) { return static_cast<block_header *>(block) - 1; }
+
+} // namespace
+
+buffer_arena &buffer_arena::local()
+{
+    thread_local buffer_arena arena;
+    return arena;
+}
+
+bool buffer_arena::grow(const std::size_t bytes)
+{
+    if (bytes <= capacity)
+        return true;
+    const std::size_t new_capacity{round_up(bytes, arena_granularity)};
+    // WHY free first? The old contents are dead; holding both would double the peak.
+    data.reset();
+    // WHY std::nothrow, and no zeroing? Decoders overwrite the memory; a failure falls back to their own allocation.
+    data.reset(new (std::nothrow) uint8_t[new_capacity]);
+    if (!data) {
+        total_arena_bytes.fetch_sub(capacity, std::memory_order_relaxed);
+        capacity = 0;
+        return false;
+    }
+
+    if (capacity == 0)
+        arena_count.fetch_add(1, std::memory_order_relaxed);
+    total_arena_bytes.fetch_add(new_capacity - capacity, std::memory_order_relaxed);
+    std::size_t largest{largest_arena_bytes.load(std::memory_order_relaxed)};
+    while (largest < new_capacity && !largest_arena_bytes.compare_exchange_weak(largest, new_capacity, std::memory_order_relaxed)) {
+    }
+    capacity = new_capacity;
+    return true;
+}
+
+uint8_t *buffer_arena::claim(const std::size_t bytes)
+{
+    if (held.exchange(true, std::memory_order_acquire))
+        return nullptr;
+    if (!grow(bytes)) {
+        release();
+        return nullptr;
+    }
+    return data.get();
+}
+
+void buffer_arena::release() { held.store(false, std::memory_order_release); }
+
+bool buffer_arena::begin_bump()
+{
+    if (held.exchange(true, std::memory_order_acquire))
+        return false;
+    // WHY grow to the last session's need? Bump blocks cannot move, so the arena cannot grow
+    // during a session; what did not fit last time came from the heap.
+    grow(bump_needed);
+    bump_top = 0;
+    bump_overflow = 0;
+    bump_needed = 0;
+    bump_arena = this;
+    return true;
+}
+
+void buffer_arena::end_bump() { bump_arena = nullptr; }
+
+arena_usage buffer_arena::usage()
+{
+    return {arena_count.load(std::memory_order_relaxed), largest_arena_bytes.load(std::memory_order_relaxed),
+            total_arena_bytes.load(std::memory_order_relaxed)};
+}
+
+void *arena_malloc(const std::size_t size)
+{
+    buffer_arena *const arena{bump_arena};
+    block_header *header{nullptr};
+    if (arena) {
+        const std::size_t footprint{block_footprint(size)};
+        if (arena->bump_top + footprint <= arena->capacity) {
+            header = reinterpret_cast<block_header *>(arena->data.get() + arena->bump_top);
+            arena->bump_top += footprint;
+            arena->bump_needed = std::max(arena->bump_needed, arena->bump_top + arena->bump_overflow);
+            *header = {size, true};
+            return header + 1;
+        }
+        arena->bump_overflow += footprint;
+        arena->bump_needed = std::max(arena->bump_needed, arena->bump_top + arena->bump_overflow);
+    }
+    header = static_cast<block_header *>(std::malloc(sizeof(block_header) + size));
+    if (!header)
+        return nullptr;
+    *header = {size, false};
+    return header + 1;
+}
+
+void arena_free(void *block)
+{
+    if (!block)
+        return;
+    block_header *const header{header_of(block)};
+    if (!header->in_arena) {
+        std::free(header);
+        return;
+    }
+    // WHY only the last block? A bump allocator cannot reuse holes; popping the top still
+    // recovers the common free-then-allocate-again pattern. Other blocks go with release().
+    buffer_arena *const arena{bump_arena};
+    if (arena && reinterpret_cast<uint8_t *>(header) + block_footprint(header->size) == arena->data.get() + arena->bump_top)
+        arena->bump_top = static_cast<std::size_t>(reinterpret_cast<uint8_t *>(header) - arena->data.get());
+}
+
+void *arena_realloc(void *block, const std::size_t size)
+{
+    if (!block)
+        return arena_malloc(size);
+    block_header *const header{header_of(block)};
+
+    // WHY grow the top block in place? stb_image grows its zlib output and PNG data buffers
+    // with realloc() while nothing else is allocated after them.
+    buffer_arena *const arena{bump_arena};
+    if (header->in_arena && arena) {
+        uint8_t *const start{reinterpret_cast<uint8_t *>(header)};
+        const std::size_t offset{static_cast<std::size_t>(start - arena->data.get())};
+        if (start + block_footprint(header->size) == arena->data.get() + arena->bump_top &&
+            offset + block_footprint(size) <= arena->capacity) {
+            arena->bump_top = offset + block_footprint(size);
+            arena->bump_needed = std::max(arena->bump_needed, arena->bump_top + arena->bump_overflow);
+            header->size = size;
+            return block;
+        }
+    }
+
+    void *const moved{arena_malloc(size)};
+    if (!moved)
+        return nullptr; // WHY keep `block`? realloc() leaves the old block intact on failure.
+    std::memcpy(moved, block, std::min(header->size, size));
+    arena_free(block);
+    return moved;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Totals over every buffer_arena of the process (for --stats).
+struct arena_usage {
+    std::size_t arena_count{0};   // Threads that decoded at least one image into their arena.
+    std::size_t largest_bytes{0}; // High-water mark of a single arena.
+    std::size_t total_bytes{0};   // High-water mark of all arenas together.
+};
+
+// A block of memory one thread reuses for image after image.
+// WHY? At thousands of images per second, a fresh multi-megabyte pixel buffer per image costs a
+// malloc, an mmap, a page fault per 4 KiB page and an munmap. An arena grows to fit the largest
+// image its thread has decoded and is then recycled, so those costs stop after the first images.
+//
+// An arena holds one image at a time: from claim() or begin_bump() until release(). While it is
+// held, claim() and begin_bump() refuse and the caller allocates as before, so code that keeps two
+// images alive on one thread stays correct, only slower.
+class buffer_arena {
+  public:
+    // The calling thread's arena, created on first use and freed when the thread exits.
+    // Memory from it must be released before that.
+    static buffer_arena &local();
+
+    // Returns `bytes` of memory, or null when the arena is held (or cannot grow).
+    uint8_t *claim(std::size_t bytes);
+
+    // Makes the memory handed out since claim() or begin_bump() reusable. Any thread may call it.
+    void release();
+
+    // Routes arena_malloc(), arena_realloc() and arena_free() on this thread to a bump allocator
+    // over the arena, for libraries that allocate several blocks per image and return one of them
+    // (stb_image). Returns false when the arena is held. Blocks that do not fit come from the heap,
+    // and the arena grows to fit them before the next image.
+    bool begin_bump();
+
+    // Stops routing; blocks handed out stay valid until release().
+    void end_bump();
+
+    // Totals over all arenas so far.
+    static arena_usage usage();
+
+    buffer_arena() = default;
+    buffer_arena(const buffer_arena &) = delete;
+    buffer_arena &operator=(const buffer_arena &) = delete;
+
+  private:
+    friend void *arena_malloc(std::size_t size);
+    friend void *arena_realloc(void *block, std::size_t size);
+    friend void arena_free(void *block);
+
+    bool grow(std::size_t bytes);
+
+    std::unique_ptr<uint8_t[]> data;
+    std::size_t capacity{0};
+    // WHY atomic? The image may be dropped, and release() called, on another thread than the owner's.
+    std::atomic<bool> held{false};
+
+    // Bump allocator state, only touched by the owning thread during begin_bump() .. end_bump().
+    std::size_t bump_top{0};      // Arena bytes in use by bump blocks.
+    std::size_t bump_overflow{0}; // Bytes of the session's blocks that did not fit and came from the heap.
+    std::size_t bump_needed{0};   // Peak of bump_top + bump_overflow: the arena size that would have held all blocks.
+};
+
+// malloc()/realloc()/free() replacements for stb_image's STBI_MALLOC etc. Inside a bump session
+// (see buffer_arena::begin_bump()) blocks come from the thread's arena; otherwise from the heap.
+// Blocks from either source may be passed to arena_realloc() and arena_free() at any time.
+void *arena_malloc(std::size_t size);
+void *arena_realloc(void *block, std::size_t size);
+void arena_free(void *block);
@@ -0,0 +1,101 @@
+#include "chroma_index.hh"
+
+#include <cmath>
+#include <memory>
+
+#include "lut.hh" // For compute_chroma_squared
+
+// One summary as stored in the index file.
+struct chroma_index::record {
+    uint64_t path_hash;
+    file_identity identity;
+    chroma_summary summary;
+};
+
+namespace {
+
+constexpr char index_magic[8]{'C', 'P', 'I', 'X', 'H', 'I', 'S', 'T'};
+constexpr uint32_t index_version{2}; // 2: chroma from the correctly rounded cube root.
+
+using bin_table_t = std::array<uint8_t, std::size_t{1} << 24>;
+
+// Bin of every RGB value, indexed R | G << 8 | B << 16 like chroma_bitset_t.
+const bin_table_t &chroma_bin_table()
+{
+    // WHY a function-local static? Built once, on first use, and C++ makes that thread-safe.
+    static const std::unique_ptr<const bin_table_t> table{[] {
+        std::array<float, CHROMA_HISTOGRAM_BINS> bin_start_squared;
+        for (int k = 0; k < CHROMA_HISTOGRAM_BINS; ++k) {
+            // WHY k / 10.f squared in float? It is exactly the test --exact makes for "-t k/10".
+            const float bin_start{static_cast<float>(k) / 10.f};
+            bin_start_squared[k] = bin_start * bin_start;
+        }
+        auto bins = std::make_unique<bin_table_t>();
+        for (int b = 0; b < 256; ++b) {
+            for (int g = 0; g < 256; ++g) {
+                for (int r = 0; r < 256; ++r) {
+                    const float chroma_squared{compute_chroma_squared(r, g, b)};
+                    // WHY correct the estimate? sqrt rounding may land one bin off near an edge;
+                    // the float comparisons decide, as they do in the classifier.
+                    int k{std::min(static_cast<int>(std::sqrt(chroma_squared) * 10.f), CHROMA_HISTOGRAM_BINS - 1)};
+                    while (k + 1 < CHROMA_HISTOGRAM_BINS && chroma_squared >= bin_start_squared[k + 1])
+                        ++k;
+                    while (k > 0 && chroma_squared < bin_start_squared[k])
+                        --k;
+                    (*bins)[static_cast<uint32_t>(r | g << 8 | b << 16)] = static_cast<uint8_t>(k);
+                }
+            }
+        }
+        return bins;
+    }()};
+    return *table;
+}
+
+} // namespace
+
+void count_chroma_bins(const uint8_t *rgb_pixels, const std::size_t pixel_count, std::array<uint32_t, CHROMA_HISTOGRAM_BINS> &bins)
+{
+    const bin_table_t &table{chroma_bin_table()};
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+        const uint8_t *pixel{rgb_pixels + i * 3};
+        ++bins[table[static_cast<uint32_t>(pixel[0] | pixel[1] << 8 | pixel[2] << 16)]];
+    }
+}
+
+std::optional<std::size_t> summary_colored_pixels(const chroma_summary &summary, const float chroma_threshold)
+{
+    const long k{std::lround(chroma_threshold * 10.f)};
+    if (k < 1 || k >= CHROMA_HISTOGRAM_BINS || static_cast<float>(k) / 10.f != chroma_threshold)
+        return std::nullopt;
+    std::size_t colored_pixel_count{0};
+    for (long bin = k; bin < CHROMA_HISTOGRAM_BINS; ++bin) {
+        colored_pixel_count += summary.bins[bin];
+    }
+    return colored_pixel_count;
+}
+
+bool chroma_index::open(const std::string &path)
+{
+    if (!store.open(path, index_magic, index_version, sizeof(record)))
+        return false;
+    const std::span<const record> stored{store.records<record>()};
+    records.reserve(stored.size());
+    for (const record &entry : stored) {
+        records.insert_or_assign(entry.path_hash, &entry); // Later records supersede earlier ones.
+    }
+    return true;
+}
+
+const chroma_summary *chroma_index::find(const std::string &filename, const file_identity &identity) const
+{
+    const auto found{records.find(file_path_key(filename))};
+    if (found == records.end() || found->second->identity != identity)
+        return nullptr;
+    return &found->second->summary;
+}
+
+void chroma_index::add(const std::string &filename, const file_identity &identity, const chroma_summary &summary)
+{
+    const record entry{file_path_key(filename), identity, summary};
+    store.append(&entry);
+}
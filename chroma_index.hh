@@ -0,0 +1,56 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "record_store.hh" // For the index file and file_identity
+
+// Chroma histogram bins kept per image by --index.
+// WHY 0.1 steps? Bin k starts at threshold k / 10.f, which is the float -t parses from the same
+// text ("7.5" -> 75 / 10.f), so any one-decimal threshold up to 25.5 falls on a bin edge and is
+// answered exactly. WHY 256 bins? One byte per RGB value in the bin table, 1 KiB per image.
+constexpr int CHROMA_HISTOGRAM_BINS = 256;
+
+// What the index keeps about one image: enough to answer --exact and -m queries without decoding.
+struct chroma_summary {
+    uint32_t width{0};
+    uint32_t height{0};
+    float max_chroma_squared{0.f}; // As max_chroma_squared() reports it for the decoded RGB.
+    uint32_t reserved{0};
+    // bins[k]: pixels whose chroma is at least k / 10 and below (k + 1) / 10; the last bin has no
+    // upper end. WHY 32 bits? Images above 4G pixels are simply not indexed.
+    std::array<uint32_t, CHROMA_HISTOGRAM_BINS> bins{};
+};
+
+// Adds the histogram bins of packed RGB pixels (3 bytes each) to `bins`.
+// The first call builds a 16 MiB table mapping every RGB value to its bin (thread-safe).
+void count_chroma_bins(const uint8_t *rgb_pixels, std::size_t pixel_count, std::array<uint32_t, CHROMA_HISTOGRAM_BINS> &bins);
+
+// Pixels of a summarized image that the exact classifier (--exact) counts as colored at
+// `chroma_threshold`, or std::nullopt when the threshold is not on a bin edge.
+std::optional<std::size_t> summary_colored_pixels(const chroma_summary &summary, float chroma_threshold);
+
+// A record_store of chroma summaries keyed by absolute path (--index FILE).
+class chroma_index {
+  public:
+    // Maps the index at `path`, creating it when missing. Returns false (after printing an error)
+    // when it cannot be opened or is not an index of this version.
+    bool open(const std::string &path);
+
+    // The summary stored for `filename`, or null when there is none for its current identity.
+    // Safe to call from any thread; only sees records that existed when the index was opened.
+    const chroma_summary *find(const std::string &filename, const file_identity &identity) const;
+
+    // Appends a summary. Safe to call from any thread.
+    void add(const std::string &filename, const file_identity &identity, const chroma_summary &summary);
+
+  private:
+    struct record;
+
+    record_store store;
+    // WHY a plain map? It is filled in open() and only read afterwards, so lookups need no lock.
+    std::unordered_map<uint64_t, const record *> records;
+};
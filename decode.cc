@@ -4,30 +4,66 @@
 #include <avif/avif.h>   // For AVIF decoding
 #include <webp/decode.h> // For WebP decoding
 
+#include <algorithm> // For std::min
+#include <csetjmp> // For libjpeg error recovery
 #include <cstddef>
 #include <cstdint>
+#include <cerrno>     // For EINTR
+#include <climits>    // For INT_MAX
+#include <cstdio>     // For FILE, which jpeglib.h uses without including stdio.h
 #include <cstring>    // For memcmp
-#include <fstream>    // For reading files
 #include <functional> // For std::move_only_function
 #include <iostream>   // For std::cerr
 #include <memory>     // For std::unique_ptr
+#include <span>       // For std::span, the decoders' view of the file bytes
+#include <string>     // For the null-terminated path open() needs
 #include <vector>     // For std::vector
 
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, madvise
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For read, close
+
+#include <jpeglib.h> // For JPEG decoding (libjpeg-turbo)
+
+#include "arena.hh" // For buffer_arena, which pixel buffers are recycled from
+
 // --- Include stb_image for other formats (JPEG, PNG, etc.) ---
 // WHY define STB_IMAGE_IMPLEMENTATION here? Required by stb_image.h in exactly
 // one .c or .cc file to create the implementation.
 #define STB_IMAGE_IMPLEMENTATION
+// WHY replace stb's allocator? decode_other() lets it allocate from the worker's arena (see arena.hh).
+#define STBI_MALLOC(size) arena_malloc(size)
+#define STBI_REALLOC(block, size) arena_realloc(block, size)
+#define STBI_FREE(block) arena_free(block)
 #include "include/stb_image.h" // Path relative to this file assumed.
 
 // Anonymous namespace limits visibility of helpers to this file only.
 namespace {
 
+// Returns an uninitialized pixel buffer of `bytes`, from the calling thread's arena when it is free.
+// WHY? Recycling the buffer saves a large allocation, its page faults and its munmap per image.
+smart_pixels_ptr allocate_pixels(const std::size_t bytes)
+{
+    buffer_arena &arena{buffer_arena::local()};
+    if (uint8_t *const pixels{arena.claim(bytes)}) {
+        return smart_pixels_ptr(pixels, [&arena](uint8_t *) { arena.release(); });
+    }
+    // WHY std::nothrow? Avoids exceptions on allocation failure, returns null instead.
+    return smart_pixels_ptr(new (std::nothrow) uint8_t[bytes], [](uint8_t *p) { delete[] p; });
+}
+
 // Represents the detected image file type based on header magic bytes.
-enum class file_type { AVIF, WEBP, OTHER, UNKNOWN }; // Added UNKNOWN for clarity
+enum class file_type { AVIF, WEBP, JPEG, OTHER, UNKNOWN }; // Added UNKNOWN for clarity
 
 // Detects image file type by inspecting the first few bytes (header/magic bytes).
-file_type detect_file_type(const std::vector<uint8_t> &header_bytes)
+file_type detect_file_type(const std::span<const uint8_t> header_bytes)
 {
+    // WHY FF D8 FF? Every JPEG starts with an SOI marker (FF D8) followed by another marker.
+    if (header_bytes.size() >= 3 && header_bytes[0] == 0xFF && header_bytes[1] == 0xD8 && header_bytes[2] == 0xFF) {
+        return file_type::JPEG;
+    }
+
     // WHY check size >= 12? Minimum size needed to potentially identify WebP or AVIF.
     if (header_bytes.size() >= 12) {
         // WHY memcmp for WebP? Checks for "RIFF" at offset 0 and "WEBP" at offset 8.
@@ -56,8 +92,44 @@ file_type detect_file_type(const std::vector<uint8_t> &header_bytes)
     return file_type::OTHER;
 }
 
-// Decodes an AVIF image buffer into RGB pixel data.
-smart_pixels_ptr decode_avif(const std::vector<uint8_t> &image_buffer, int &image_width, int &image_height)
+// Luma weights for the ITU-T H.273 matrix coefficients of an AVIF image.
+// Returns false for matrices that are not a plain Kr/Kb YCbCr matrix (identity/GBR, YCgCo,
+// constant luminance, ICtCp, chroma-derived); those images are converted to RGB by libavif.
+bool avif_yuv_conversion(const avifImage &image, yuv_conversion &conversion)
+{
+    // WHY these values? The same per-matrix table libavif uses (colr.c); unspecified falls back to BT.601 as there.
+    switch (image.matrixCoefficients) {
+    case AVIF_MATRIX_COEFFICIENTS_BT709:
+        conversion.kr = 0.2126f;
+        conversion.kb = 0.0722f;
+        break;
+    case AVIF_MATRIX_COEFFICIENTS_FCC:
+        conversion.kr = 0.30f;
+        conversion.kb = 0.11f;
+        break;
+    case AVIF_MATRIX_COEFFICIENTS_UNSPECIFIED:
+    case AVIF_MATRIX_COEFFICIENTS_BT470BG:
+    case AVIF_MATRIX_COEFFICIENTS_BT601:
+        conversion.kr = 0.299f;
+        conversion.kb = 0.114f;
+        break;
+    case AVIF_MATRIX_COEFFICIENTS_SMPTE240:
+        conversion.kr = 0.212f;
+        conversion.kb = 0.087f;
+        break;
+    case AVIF_MATRIX_COEFFICIENTS_BT2020_NCL:
+        conversion.kr = 0.2627f;
+        conversion.kb = 0.0593f;
+        break;
+    default:
+        return false;
+    }
+    conversion.full_range = image.yuvRange == AVIF_RANGE_FULL;
+    return true;
+}
+
+// Decodes an AVIF image buffer into RGB pixel data, or hands out its YUV planes (see decode_image()).
+smart_pixels_ptr decode_avif(const std::span<const uint8_t> image_buffer, int &image_width, int &image_height, yuv_planes *yuv)
 {
     // --- Setup AVIF Decoder ---
     // WHY unique_ptr with custom deleter? Ensures avifDecoderDestroy is called via RAII, even on errors.
@@ -91,89 +163,112 @@ smart_pixels_ptr decode_avif(const std::vector<uint8_t> &image_buffer, int &imag
     image_width = image->width;
     image_height = image->height;
 
-    // --- Prepare RGB Output Structure ---
-    // WHY custom deleter lambda? avifRGBImage needs two-step cleanup: free pixels buffer, then delete struct.
-    auto avif_rgb_image_deleter = [](avifRGBImage *rgb_img_ptr) {
-        if (rgb_img_ptr) {
-            // WHY avifRGBImageFreePixels? Frees the buffer allocated by avifRGBImageAllocatePixels.
-            avifRGBImageFreePixels(rgb_img_ptr);
-            // WHY delete? Frees the avifRGBImage struct itself allocated via 'new'.
-            delete rgb_img_ptr;
-        }
-    };
-    // WHY unique_ptr type with decltype? Manages avifRGBImage struct lifetime using the custom lambda deleter.
-    using avif_rgb_image_ptr = std::unique_ptr<avifRGBImage, decltype(avif_rgb_image_deleter)>;
+    // --- Keep YUV Planes ---
+    // WHY? Classifying straight from the planes skips the RGB buffer (3 bytes per pixel) and the
+    // avifImageYUVToRGB() pass; with 4:2:0 the chroma planes are only a quarter of the pixels each.
+    // WHY 8-bit only? The classification tables are indexed by 8-bit Y, U and V.
+    // WHY not 4:0:0? Monochrome images have no chroma planes; libavif converts them as before.
+    yuv_conversion conversion;
+    if (yuv && image->depth == 8 && image->yuvFormat != AVIF_PIXEL_FORMAT_YUV400 && image->yuvPlanes[AVIF_CHAN_Y] &&
+        image->yuvPlanes[AVIF_CHAN_U] && image->yuvPlanes[AVIF_CHAN_V] && avif_yuv_conversion(*image, conversion)) {
+        yuv->y_plane = image->yuvPlanes[AVIF_CHAN_Y];
+        yuv->u_plane = image->yuvPlanes[AVIF_CHAN_U];
+        yuv->v_plane = image->yuvPlanes[AVIF_CHAN_V];
+        yuv->y_stride = image->yuvRowBytes[AVIF_CHAN_Y];
+        yuv->uv_stride = image->yuvRowBytes[AVIF_CHAN_U];
+        yuv->chroma_shift_x = image->yuvFormat == AVIF_PIXEL_FORMAT_YUV444 ? 0 : 1;
+        yuv->chroma_shift_y = image->yuvFormat == AVIF_PIXEL_FORMAT_YUV420 ? 1 : 0;
+        yuv->conversion = conversion;
+
+        // WHY capture the image? It owns the planes; the decoder is no longer needed.
+        uint8_t *y_plane = image->yuvPlanes[AVIF_CHAN_Y];
+        return smart_pixels_ptr(y_plane, [image_owner = std::move(image)](uint8_t *) { /* owns image_owner */ });
+    }
 
-    // WHY allocate struct on heap (new)? Its lifetime is tied to the returned pixel buffer's deleter,
-    // extending beyond this function's scope via the capture in the final smart_pixels_ptr deleter.
-    // WHY std::nothrow? Avoids exceptions on allocation failure, returns null instead.
-    avif_rgb_image_ptr rgb_image_struct(new (std::nothrow) avifRGBImage{}, avif_rgb_image_deleter);
-    // WHY check rgb_image_struct? Allocation can fail.
-    if (!rgb_image_struct) {
-        std::cerr << "ERROR: Failed to allocate avifRGBImage struct\n";
+    // --- Prepare RGB Output ---
+    // WHY our own buffer? libavif converts into caller-provided pixels, so the buffer can come from
+    // the worker's arena instead of avifRGBImageAllocatePixels().
+    // WHY static_cast? Ensure multiplication happens with sufficient width before potential overflow.
+    const std::size_t row_bytes{static_cast<std::size_t>(image_width) * 3};
+    smart_pixels_ptr pixels{allocate_pixels(row_bytes * static_cast<std::size_t>(image_height))};
+    if (!pixels) {
+        std::cerr << "ERROR: Failed to allocate RGB pixels for AVIF image\n";
         return {};
     }
 
     // Configure the RGB output format.
-    avifRGBImageSetDefaults(rgb_image_struct.get(), image.get()); // Inherit color profile etc.
-    rgb_image_struct->format = AVIF_RGB_FORMAT_RGB;               // Request 3-channel, 8-bit RGB.
-    rgb_image_struct->depth = 8;
-    // WHY static_cast? Ensure multiplication happens with sufficient width before potential overflow.
+    // WHY on the stack? It only describes `pixels` during the conversion and owns nothing.
+    avifRGBImage rgb_image;
+    avifRGBImageSetDefaults(&rgb_image, image.get()); // Inherit color profile etc.
+    rgb_image.format = AVIF_RGB_FORMAT_RGB;           // Request 3-channel, 8-bit RGB.
+    rgb_image.depth = 8;
     // WHY width * 3? Stride calculation: pixels per row * channels per pixel * bytes per channel.
-    rgb_image_struct->rowBytes = static_cast<uint32_t>(image_width) * 3;
-    rgb_image_struct->pixels = nullptr; // Ensure null before allocation.
-
-    // --- Allocate Pixel Buffer ---
-    // WHY check result? Allocation can fail (e.g., out of memory).
-    if (avifRGBImageAllocatePixels(rgb_image_struct.get()) != AVIF_RESULT_OK) {
-        std::cerr << "ERROR: avifRGBImageAllocatePixels() failed\n";
-        // rgb_image_struct's unique_ptr handles freeing the partially allocated struct on return.
-        return {};
-    }
-    // WHY check pixels pointer? Paranoid check against library bugs.
-    if (!rgb_image_struct->pixels) {
-        std::cerr << "ERROR: avifRGBImageAllocatePixels succeeded but pixels pointer is still null.\n";
-        return {};
-    }
+    rgb_image.rowBytes = static_cast<uint32_t>(row_bytes);
+    rgb_image.pixels = pixels.get();
 
     // --- Convert YUV to RGB ---
     // WHY check result? Color conversion can fail.
-    if (avifImageYUVToRGB(image.get(), rgb_image_struct.get()) != AVIF_RESULT_OK) {
+    if (avifImageYUVToRGB(image.get(), &rgb_image) != AVIF_RESULT_OK) {
         std::cerr << "ERROR: avifImageYUVToRGB() failed\n";
-        // rgb_image_struct's unique_ptr handles cleanup on return.
         return {};
     }
-
-    // --- Prepare Return Value ---
-    // WHY separate pointer variable? Avoids undefined behavior: Guarantees reading `pixels` pointer *before*
-    // `std::move(rgb_image_struct)` below. Direct use in constructor args has unspecified relative eval order.
-    // For example, the code below segfaults when compile with g++ 14.2.1.
-    // return smart_pixels_ptr(rgb_image_struct->pixels,
-    //                        [rgb_owner = std::move(rgb_image_struct)](uint8_t *) {});
-    uint8_t *pixel_data = rgb_image_struct->pixels;
-
-    // WHY capture `std::move(rgb_image_struct)`? Transfers ownership of the `avifRGBImage` struct
-    // and its cleanup logic (via `avif_rgb_image_deleter`) into the returned `smart_pixels_ptr`'s lifetime.
-    // WHY empty deleter body `[](uint8_t*){}`? Its sole purpose is to own the captured `rgb_owner`;
-    // the *destruction* of `rgb_owner` triggers the actual cleanup via `avif_rgb_image_deleter`.
-    return smart_pixels_ptr(pixel_data, [rgb_owner = std::move(rgb_image_struct)](uint8_t *) { /* owns rgb_owner */ });
+    return pixels;
 }
 
-// Decodes a WebP image buffer into RGB pixel data.
-smart_pixels_ptr decode_webp(const std::vector<uint8_t> &image_buffer, int &image_width, int &image_height)
+// Decodes a WebP image buffer into RGB pixel data, or hands out its YUV planes (see decode_image()).
+smart_pixels_ptr decode_webp(const std::span<const uint8_t> image_buffer, int &image_width, int &image_height, yuv_planes *yuv)
 {
     int temp_width{0};
     int temp_height{0};
 
-    // WHY unique_ptr with lambda deleter? Manages buffer from WebPDecodeRGB using WebPFree via RAII.
-    smart_pixels_ptr pixels{
-        // WebPDecodeRGB allocates memory; returns null on failure.
-        reinterpret_cast<uint8_t *>(WebPDecodeRGB(image_buffer.data(), image_buffer.size(), &temp_width, &temp_height)),
-        // Deleter lambda calls the correct WebP free function.
-        [](uint8_t *p) { WebPFree(p); }};
+    // --- Keep YUV Planes ---
+    // WHY? Lossy WebP is coded as 8-bit 4:2:0 YUV; WebPDecodeYUV stops before chroma upsampling and
+    // RGB conversion, and its planes take 1.5 bytes per pixel instead of 3.
+    // WHY lossy only? Lossless WebP is coded in RGB, so asking it for YUV would add a conversion.
+    WebPBitstreamFeatures features;
+    if (yuv && WebPGetFeatures(image_buffer.data(), image_buffer.size(), &features) == VP8_STATUS_OK &&
+        features.format == 1 && !features.has_animation) { // WHY 1? WebP's code for lossy.
+        temp_width = features.width;
+        temp_height = features.height;
+        // WHY Into? The planes then go to one buffer from the worker's arena, Y then U then V.
+        const std::size_t y_bytes{static_cast<std::size_t>(temp_width) * temp_height};
+        const int uv_stride{(temp_width + 1) / 2};
+        const std::size_t uv_bytes{static_cast<std::size_t>(uv_stride) * ((temp_height + 1) / 2)};
+        smart_pixels_ptr y_plane{allocate_pixels(y_bytes + 2 * uv_bytes)};
+        if (!y_plane)
+            return {};
+        uint8_t *const u_plane{y_plane.get() + y_bytes}; // WHY after the check? Offsetting a null pointer is undefined.
+        uint8_t *const v_plane{u_plane + uv_bytes};
+        if (!WebPDecodeYUVInto(image_buffer.data(), image_buffer.size(), y_plane.get(), y_bytes, temp_width, u_plane, uv_bytes,
+                               uv_stride, v_plane, uv_bytes, uv_stride)) {
+            return {};
+        }
 
-    // WHY check pixels? Decode function returns null on error.
-    if (!pixels) {
+        yuv->y_plane = y_plane.get();
+        yuv->u_plane = u_plane;
+        yuv->v_plane = v_plane;
+        yuv->y_stride = static_cast<std::size_t>(temp_width);
+        yuv->uv_stride = static_cast<std::size_t>(uv_stride);
+        yuv->chroma_shift_x = 1;
+        yuv->chroma_shift_y = 1;
+        yuv->conversion = yuv_conversion{.formula = yuv_formula::LIBWEBP};
+
+        image_width = temp_width;
+        image_height = temp_height;
+        return y_plane;
+    }
+
+    // WHY WebPDecodeRGBInto? It decodes into our buffer, which can come from the worker's arena.
+    if (!WebPGetInfo(image_buffer.data(), image_buffer.size(), &temp_width, &temp_height)) {
+        return {};
+    }
+    const std::size_t row_bytes{static_cast<std::size_t>(temp_width) * 3};
+    const std::size_t pixel_bytes{row_bytes * static_cast<std::size_t>(temp_height)};
+    smart_pixels_ptr pixels{allocate_pixels(pixel_bytes)};
+
+    // WHY check the result? Decode function returns null on error.
+    if (!pixels ||
+        !WebPDecodeRGBInto(image_buffer.data(), image_buffer.size(), pixels.get(), pixel_bytes, static_cast<int>(row_bytes))) {
         return {};
     }
 
@@ -183,73 +278,353 @@ smart_pixels_ptr decode_webp(const std::vector<uint8_t> &image_buffer, int &imag
     return pixels; // Transfer ownership of the unique_ptr.
 }
 
-// Decodes other image formats (JPEG, PNG, etc.) using stb_image.
-smart_pixels_ptr decode_other(const std::vector<uint8_t> &image_buffer, int &image_width, int &image_height)
+// libjpeg reports fatal errors through error_exit, which must not return.
+// WHY setjmp/longjmp? It is the error model libjpeg is built for; throwing a C++ exception through
+// its C frames is not safe. The functions that call setjmp hold no objects with destructors.
+struct jpeg_error_handler {
+    jpeg_error_mgr manager; // WHY first? libjpeg only knows the jpeg_error_mgr part of this struct.
+    std::jmp_buf jump_buffer;
+};
+
+[[noreturn]] void jpeg_error_exit(j_common_ptr jpeg_info)
+{
+    std::longjmp(reinterpret_cast<jpeg_error_handler *>(jpeg_info->err)->jump_buffer, 1);
+}
+
+// WHY silence messages? Warnings such as "Premature end of JPEG file" would flood stderr for
+// slightly damaged files that still decode; a fatal error is reported by decode_image().
+void jpeg_output_message(j_common_ptr) {}
+
+// Creates the decompressor, reads the header and starts decompression to RGB at 1/scale_denom size.
+// Returns false on a libjpeg error.
+bool start_jpeg_decompress(jpeg_decompress_struct &jpeg_info, jpeg_error_handler &errors,
+                           const std::span<const uint8_t> image_buffer, const int scale_denom)
+{
+    if (setjmp(errors.jump_buffer))
+        return false;
+
+    jpeg_create_decompress(&jpeg_info);
+    jpeg_mem_src(&jpeg_info, image_buffer.data(), image_buffer.size());
+    jpeg_read_header(&jpeg_info, TRUE);
+    jpeg_info.out_color_space = JCS_RGB; // Request 3-channel RGB; grayscale input is expanded.
+    // WHY scale in the decoder? libjpeg then runs a reduced IDCT per 8x8 block (only the DC term at
+    // 1/8) instead of decoding every pixel and throwing most of them away.
+    jpeg_info.scale_num = 1;
+    jpeg_info.scale_denom = scale_denom;
+    jpeg_start_decompress(&jpeg_info);
+    return true;
+}
+
+// Decodes up to `row_count` more scanlines into `rows` (output_width * 3 bytes each) and finishes
+// decompression after the last scanline of the image. Returns false on a libjpeg error.
+bool read_jpeg_rows(jpeg_decompress_struct &jpeg_info, jpeg_error_handler &errors, uint8_t *rows, const size_t row_count)
+{
+    if (setjmp(errors.jump_buffer))
+        return false;
+
+    const size_t row_bytes{static_cast<size_t>(jpeg_info.output_width) * 3};
+    const size_t first_row{jpeg_info.output_scanline};
+    const size_t end_row{std::min<size_t>(first_row + row_count, jpeg_info.output_height)};
+    while (jpeg_info.output_scanline < end_row) {
+        // WHY several rows per call? libjpeg emits up to rec_outbuf_height rows at once when it upsamples.
+        // WHY never past end_row? Every row libjpeg returns is consumed, so a band must not ask for more.
+        const size_t batch_rows{std::min<size_t>(4, end_row - jpeg_info.output_scanline)};
+        JSAMPROW batch[4];
+        for (size_t i = 0; i < batch_rows; ++i) {
+            batch[i] = rows + (jpeg_info.output_scanline - first_row + i) * row_bytes;
+        }
+        jpeg_read_scanlines(&jpeg_info, batch, static_cast<JDIMENSION>(batch_rows));
+    }
+    if (jpeg_info.output_scanline == jpeg_info.output_height)
+        jpeg_finish_decompress(&jpeg_info);
+    return true;
+}
+
+// Sets up `jpeg_info` to report errors through `errors`.
+void init_jpeg_errors(jpeg_decompress_struct &jpeg_info, jpeg_error_handler &errors)
+{
+    jpeg_info.err = jpeg_std_error(&errors.manager);
+    errors.manager.error_exit = jpeg_error_exit;
+    errors.manager.output_message = jpeg_output_message;
+}
+
+// Decodes a JPEG image buffer into RGB pixel data, optionally scaled down by 2, 4 or 8.
+// WHY libjpeg-turbo instead of stb_image? Its SIMD IDCT and color conversion decode several
+// times faster, and only it can decode directly at reduced size.
+smart_pixels_ptr decode_jpeg(const std::span<const uint8_t> image_buffer, int &image_width, int &image_height,
+                             const int scale_denom)
+{
+    jpeg_decompress_struct jpeg_info{};
+    jpeg_error_handler errors{};
+    init_jpeg_errors(jpeg_info, errors);
+
+    // WHY unique_ptr with custom deleter? Ensures jpeg_destroy_decompress is called via RAII on every path.
+    // (It is a no-op on the zeroed struct if creation itself fails.)
+    using decompress_guard = std::unique_ptr<jpeg_decompress_struct, decltype(&jpeg_destroy_decompress)>;
+    const decompress_guard guard(&jpeg_info, jpeg_destroy_decompress);
+
+    if (!start_jpeg_decompress(jpeg_info, errors, image_buffer, scale_denom)) {
+        return {};
+    }
+
+    smart_pixels_ptr pixels{allocate_pixels(static_cast<size_t>(jpeg_info.output_width) * jpeg_info.output_height * 3)};
+    if (!pixels || !read_jpeg_rows(jpeg_info, errors, pixels.get(), jpeg_info.output_height)) {
+        return {};
+    }
+
+    // Update output dimensions (the scaled size).
+    image_width = static_cast<int>(jpeg_info.output_width);
+    image_height = static_cast<int>(jpeg_info.output_height);
+    return pixels;
+}
+
+// Streams a JPEG through one band buffer (see decode_image_bands()).
+band_status stream_jpeg(const std::span<const uint8_t> image_buffer, int &image_width, int &image_height, const int scale_denom,
+                        const std::size_t band_bytes, band_consumer &consume)
+{
+    jpeg_decompress_struct jpeg_info{};
+    jpeg_error_handler errors{};
+    init_jpeg_errors(jpeg_info, errors);
+    using decompress_guard = std::unique_ptr<jpeg_decompress_struct, decltype(&jpeg_destroy_decompress)>;
+    const decompress_guard guard(&jpeg_info, jpeg_destroy_decompress);
+
+    // WHY UNSUPPORTED on a bad header? decode_image() then tries stb_image, as for a whole decode.
+    if (!start_jpeg_decompress(jpeg_info, errors, image_buffer, scale_denom)) {
+        return band_status::UNSUPPORTED;
+    }
+    const size_t row_bytes{static_cast<size_t>(jpeg_info.output_width) * 3};
+    if (row_bytes * jpeg_info.output_height <= band_bytes) {
+        return band_status::UNSUPPORTED;
+    }
+    const size_t band_rows{std::max<size_t>(band_bytes / row_bytes, 1)};
+    const smart_pixels_ptr band{allocate_pixels(band_rows * row_bytes)};
+    if (!band) {
+        return band_status::UNSUPPORTED;
+    }
+
+    image_width = static_cast<int>(jpeg_info.output_width);
+    image_height = static_cast<int>(jpeg_info.output_height);
+    while (jpeg_info.output_scanline < jpeg_info.output_height) {
+        const size_t first_row{jpeg_info.output_scanline};
+        if (!read_jpeg_rows(jpeg_info, errors, band.get(), band_rows)) {
+            return first_row == 0 ? band_status::UNSUPPORTED : band_status::FAILED;
+        }
+        // WHY no jpeg_abort on STOPPED? The guard's jpeg_destroy_decompress releases a decompressor in any state.
+        if (!consume(band.get(), first_row, jpeg_info.output_scanline - first_row)) {
+            return band_status::STOPPED;
+        }
+    }
+    return band_status::COMPLETE;
+}
+
+// Streams a WebP through libwebp's incremental decoder (see decode_image_bands()).
+band_status stream_webp(const std::span<const uint8_t> image_buffer, int &image_width, int &image_height,
+                        const std::size_t band_bytes, const bool yuv_wanted, band_consumer &consume)
+{
+    WebPBitstreamFeatures features;
+    // WHY not animations? The incremental decoder only handles still images.
+    if (WebPGetFeatures(image_buffer.data(), image_buffer.size(), &features) != VP8_STATUS_OK || features.has_animation ||
+        (yuv_wanted && features.format == 1)) { // WHY 1? WebP's code for lossy.
+        return band_status::UNSUPPORTED;
+    }
+    const size_t row_bytes{static_cast<size_t>(features.width) * 3};
+    const size_t pixel_bytes{row_bytes * static_cast<size_t>(features.height)};
+    if (pixel_bytes <= band_bytes) {
+        return band_status::UNSUPPORTED;
+    }
+    const smart_pixels_ptr pixels{allocate_pixels(pixel_bytes)};
+    if (!pixels) {
+        return band_status::UNSUPPORTED;
+    }
+    // WHY unique_ptr with custom deleter? Ensures WebPIDelete is called via RAII; it leaves our buffer alone.
+    using idecoder_ptr = std::unique_ptr<WebPIDecoder, decltype(&WebPIDelete)>;
+    const idecoder_ptr decoder(WebPINewRGB(MODE_RGB, pixels.get(), pixel_bytes, static_cast<int>(row_bytes)), WebPIDelete);
+    if (!decoder) {
+        return band_status::UNSUPPORTED;
+    }
+
+    image_width = features.width;
+    image_height = features.height;
+    const size_t band_rows{std::max<size_t>(band_bytes / row_bytes, 1)};
+    // WHY feed the file in slices? Each WebPIUpdate() call then decodes about one band of rows.
+    const size_t slice_bytes{std::max<size_t>(image_buffer.size() * band_rows / static_cast<size_t>(image_height), 4096)};
+    size_t fed_bytes{0};
+    size_t delivered_rows{0};
+    while (true) {
+        fed_bytes = std::min(image_buffer.size(), fed_bytes + slice_bytes);
+        // WHY WebPIUpdate? The data is already in memory; it re-reads the prefix instead of copying it.
+        const VP8StatusCode status{WebPIUpdate(decoder.get(), image_buffer.data(), fed_bytes)};
+        if (status != VP8_STATUS_OK && status != VP8_STATUS_SUSPENDED) {
+            return delivered_rows == 0 ? band_status::UNSUPPORTED : band_status::FAILED;
+        }
+
+        int decoded_rows{0};
+        WebPIDecGetRGB(decoder.get(), &decoded_rows, nullptr, nullptr, nullptr);
+        while (delivered_rows < static_cast<size_t>(decoded_rows)) {
+            const size_t rows{std::min(band_rows, static_cast<size_t>(decoded_rows) - delivered_rows)};
+            if (!consume(pixels.get() + delivered_rows * row_bytes, delivered_rows, rows)) {
+                return band_status::STOPPED;
+            }
+            delivered_rows += rows;
+        }
+
+        if (status == VP8_STATUS_OK && delivered_rows == static_cast<size_t>(image_height)) {
+            return band_status::COMPLETE;
+        }
+        // WHY give up when all data is in? The file is truncated; a whole decode would fail too.
+        if (status == VP8_STATUS_OK || fed_bytes == image_buffer.size()) {
+            return delivered_rows == 0 ? band_status::UNSUPPORTED : band_status::FAILED;
+        }
+    }
+}
+
+// Decodes other image formats (PNG, GIF, BMP, etc.) using stb_image.
+smart_pixels_ptr decode_other(const std::span<const uint8_t> image_buffer, int &image_width, int &image_height)
 {
     int temp_width{0};
     int temp_height{0};
     int channels_in_file{0}; // We don't use this but stb_image requires it.
 
-    // WHY unique_ptr with lambda deleter? Manages buffer from stbi_load_from_memory using stbi_image_free via RAII.
-    smart_pixels_ptr pixels{
-        // Request 3 channels (RGB). stbi_load will convert if necessary (e.g., RGBA -> RGB). Returns null on failure.
-        stbi_load_from_memory(image_buffer.data(), image_buffer.size(), &temp_width, &temp_height, &channels_in_file, 3),
-        // Deleter lambda calls the correct stb_image free function.
-        [](uint8_t *p) { stbi_image_free(p); }};
+    // WHY check size? stb_image takes the length as int.
+    if (image_buffer.size() > INT_MAX) {
+        return {};
+    }
+
+    // WHY a bump session? stb_image cannot decode into our buffer, but its allocations (the result
+    // and its scratch buffers) can come from the worker's arena.
+    buffer_arena &arena{buffer_arena::local()};
+    buffer_arena *const bump_arena{arena.begin_bump() ? &arena : nullptr};
+    // Request 3 channels (RGB). stbi_load will convert if necessary (e.g., RGBA -> RGB). Returns null on failure.
+    uint8_t *const loaded{stbi_load_from_memory(image_buffer.data(), static_cast<int>(image_buffer.size()), &temp_width,
+                                                &temp_height, &channels_in_file, 3)};
+    if (bump_arena)
+        bump_arena->end_bump();
 
     // WHY check pixels? Load function returns null on error.
-    if (!pixels) {
+    if (!loaded) {
+        if (bump_arena)
+            bump_arena->release();
         return {};
     }
 
+    // WHY unique_ptr with lambda deleter? stbi_image_free frees the result if it came from the heap;
+    // the arena, when used, is released with it.
+    smart_pixels_ptr pixels{loaded, [bump_arena](uint8_t *p) {
+                                stbi_image_free(p);
+                                if (bump_arena)
+                                    bump_arena->release();
+                            }};
+
     // Update output dimensions.
     image_width = temp_width;
     image_height = temp_height;
     return pixels; // Transfer ownership.
 }
 
+// Reads from `fd` until end of file, appending to `buffer`.
+// WHY not rely on the size? Pipes and special files report 0 or a wrong size in fstat().
+bool read_until_eof(const int fd, std::vector<uint8_t> &buffer)
+{
+    constexpr std::size_t read_chunk{1 << 20};
+    std::size_t used{buffer.size()};
+    while (true) {
+        buffer.resize(used + read_chunk);
+        const ssize_t got{read(fd, buffer.data() + used, read_chunk)};
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got < 0) {
+            buffer.clear();
+            return false;
+        }
+        if (got == 0)
+            break;
+        used += static_cast<std::size_t>(got);
+    }
+    buffer.resize(used);
+    return true;
+}
+
 } // namespace
 
-// Decodes an image file (AVIF, WebP, or other) into an RGB pixel buffer.
-// Automatically detects format and uses the appropriate decoder.
-smart_pixels_ptr decode_image(std::string_view filename, int &width, int &height)
+input_file::~input_file()
+{
+    if (mapping)
+        munmap(mapping, mapping_size);
+}
+
+bool open_input_file(const std::string_view filename, input_file &file)
 {
-    // --- Read File Content ---
-    // WHY ifstream? Standard C++ way to read files.
-    // WHY binary | ate? Open in binary mode, start at the end (to easily get size).
-    std::ifstream file_stream(std::string(filename), std::ios::binary | std::ios::ate);
-    // WHY check stream? File might not exist or be readable.
-    if (!file_stream) {
+    // WHY unique_ptr for the descriptor? Closes it on every return path (RAII); the mapping stays valid after close.
+    const int fd{open(std::string(filename).c_str(), O_RDONLY | O_CLOEXEC)};
+    // WHY check fd? File might not exist or be readable.
+    if (fd < 0) {
         std::cerr << "ERROR: Cannot open file: " << filename << "\n";
-        return {};
+        return false;
     }
-
-    // WHY tellg/seekg? Get file size efficiently.
-    std::streamsize file_size{file_stream.tellg()};
-    file_stream.seekg(0); // Go back to the beginning.
-
-    // WHY check size? Avoid allocating huge buffer for potentially invalid size. Add a reasonable limit?
-    if (file_size <= 0) {
-        std::cerr << "ERROR: Invalid file size (" << file_size << ") for: " << filename << "\n";
-        return {};
+    const auto close_fd = [](const int *descriptor) { close(*descriptor); };
+    const std::unique_ptr<const int, decltype(close_fd)> fd_guard(&fd, close_fd);
+
+    struct stat file_status;
+    if (fstat(fd, &file_status) == 0 && S_ISREG(file_status.st_mode)) {
+        // WHY check size? mmap() of an empty file fails, and an empty file is not an image anyway.
+        if (file_status.st_size <= 0) {
+            std::cerr << "ERROR: Invalid file size (" << file_status.st_size << ") for: " << filename << "\n";
+            return false;
+        }
+        const std::size_t file_size{static_cast<std::size_t>(file_status.st_size)};
+        void *const mapping{mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0)};
+        if (mapping != MAP_FAILED) {
+            file.mapping = mapping;
+            file.mapping_size = file_size;
+            // WHY both hints? SEQUENTIAL lets the kernel read ahead aggressively and drop pages behind
+            // the decoder; WILLNEED starts reading the whole file now instead of on first touch.
+            // NOTE: a file truncated by another process while mapped raises SIGBUS when read.
+            madvise(file.mapping, file.mapping_size, MADV_SEQUENTIAL);
+            madvise(file.mapping, file.mapping_size, MADV_WILLNEED);
+            file.bytes = {static_cast<const uint8_t *>(file.mapping), file.mapping_size};
+            return true;
+        }
+        // Some filesystems cannot be mapped; read the file instead.
+        file.buffer.reserve(file_size);
     }
 
-    // WHY vector<uint8_t>? Convenient dynamic buffer to hold file content.
-    std::vector<uint8_t> file_buffer(static_cast<size_t>(file_size));
-    // WHY check read? Ensure the entire file content was read successfully.
-    if (!file_stream.read(reinterpret_cast<char *>(file_buffer.data()), file_size)) {
+    // --- Fallback: read() for pipes, character devices and unmappable files ---
+    if (!read_until_eof(fd, file.buffer)) {
         std::cerr << "ERROR: Failed to read file content: " << filename << "\n";
+        return false;
+    }
+    if (file.buffer.empty()) {
+        std::cerr << "ERROR: Invalid file size (0) for: " << filename << "\n";
+        return false;
+    }
+    file.bytes = file.buffer;
+    return true;
+}
+
+// Decodes an image file (AVIF, WebP, or other) into an RGB pixel buffer.
+// Automatically detects format and uses the appropriate decoder.
+smart_pixels_ptr decode_image(std::string_view filename, int &width, int &height, const decode_options &options,
+                              yuv_planes *yuv)
+{
+    // --- Map File Content ---
+    input_file file;
+    if (!open_input_file(filename, file)) {
         return {};
     }
-    // File stream is automatically closed when file_stream goes out of scope (RAII).
+    return decode_image(filename, file.bytes, width, height, options, yuv);
+}
 
+// Decodes file contents that are already in memory; `filename` only labels messages.
+smart_pixels_ptr decode_image(std::string_view filename, const std::span<const uint8_t> file_buffer, int &width, int &height,
+                              const decode_options &options, yuv_planes *yuv)
+{
     // --- Detect Type and Decode ---
     file_type image_type{detect_file_type(file_buffer)};
     smart_pixels_ptr decoded_pixels;
 
     // WHY try AVIF first? If detected, attempt decoding.
     if (image_type == file_type::AVIF) {
-        decoded_pixels = decode_avif(file_buffer, width, height);
+        decoded_pixels = decode_avif(file_buffer, width, height, yuv);
         // WHY return early on success? Avoid trying other decoders unnecessarily.
         if (decoded_pixels)
             return decoded_pixels;
@@ -259,13 +634,22 @@ smart_pixels_ptr decode_image(std::string_view filename, int &width, int &height
 
     // WHY try WebP next? If detected, attempt decoding.
     if (image_type == file_type::WEBP) {
-        decoded_pixels = decode_webp(file_buffer, width, height);
+        decoded_pixels = decode_webp(file_buffer, width, height, yuv);
         if (decoded_pixels)
             return decoded_pixels;
         // If WebP decoding failed, continue to fallback.
         std::cerr << "INFO: WebP detected but decode failed, falling back: " << filename << "\n";
     }
 
+    // WHY try JPEG next? If detected, attempt decoding with libjpeg.
+    if (image_type == file_type::JPEG) {
+        decoded_pixels = decode_jpeg(file_buffer, width, height, options.jpeg_scale_denom);
+        if (decoded_pixels)
+            return decoded_pixels;
+        // If JPEG decoding failed (e.g. CMYK or truncated file), continue to fallback.
+        std::cerr << "INFO: JPEG detected but decode failed, falling back: " << filename << "\n";
+    }
+
     // --- Fallback Decoder ---
     // WHY fallback to stb_image? Handles common formats like JPEG, PNG, GIF, BMP etc.
     // It's attempted regardless of detected type if specific decoders failed or type was OTHER.
@@ -276,3 +660,28 @@ smart_pixels_ptr decode_image(std::string_view filename, int &width, int &height
     }
     return decoded_pixels;
 }
+
+band_status decode_image_bands(std::string_view filename, const std::span<const uint8_t> file_bytes, int &width, int &height,
+                               const decode_options &options, const bool yuv_wanted, band_consumer consume)
+{
+    if (options.band_bytes == 0) {
+        return band_status::UNSUPPORTED;
+    }
+
+    band_status status{band_status::UNSUPPORTED};
+    switch (detect_file_type(file_bytes)) {
+    case file_type::JPEG:
+        status = stream_jpeg(file_bytes, width, height, options.jpeg_scale_denom, options.band_bytes, consume);
+        break;
+    case file_type::WEBP:
+        status = stream_webp(file_bytes, width, height, options.band_bytes, yuv_wanted, consume);
+        break;
+    default:
+        break;
+    }
+    // WHY report here? The rows before the damage were already classified, so no fallback decoder can take over.
+    if (status == band_status::FAILED) {
+        std::cerr << "ERROR: Image data broke off while streaming: " << filename << "\n";
+    }
+    return status;
+}
@@ -1,8 +1,13 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>     // WHY: For uint8_t type.
 #include <functional>  // WHY: For std::move_only_function needed by smart pointer type.
 #include <memory>      // WHY: For std::unique_ptr.
+#include <span>        // WHY: For file contents passed in by the read-ahead stage.
 #include <string_view> // WHY: Efficiently pass filename without copying string data.
+#include <vector>
+
+#include "lut.hh" // Includes definition of yuv_conversion
 
 // Type alias for a smart pointer managing the raw pixel buffer (uint8_t array).
 // - `std::unique_ptr<uint8_t[]...>`: Owns an array allocated with new uint8_t[...] or compatible C allocator.
@@ -12,8 +17,82 @@
 //   `move_only` is efficient as the deleter itself doesn't need to be copied.
 using smart_pixels_ptr = std::unique_ptr<uint8_t[], std::move_only_function<void(uint8_t *)>>;
 
+// Settings that change how images are decoded.
+struct decode_options {
+    // WHY only JPEG? libjpeg can skip most of the IDCT work to decode at 1/2, 1/4 or 1/8 size.
+    // Other formats are always decoded at full size.
+    int jpeg_scale_denom{1}; // Decode JPEGs at 1/jpeg_scale_denom of their size (1, 2, 4 or 8).
+    // decode_image_bands() streams images whose RGB output exceeds this many bytes, in bands of
+    // about this size (0 = never stream).
+    std::size_t band_bytes{0};
+};
+
+// An 8-bit 4:4:4, 4:2:2 or 4:2:0 image left in the planes it was coded in.
+// Pixel (x, y) has luma y_plane[y * y_stride + x] and chroma samples at
+// (x >> chroma_shift_x, y >> chroma_shift_y) in u_plane and v_plane (stride uv_stride).
+struct yuv_planes {
+    const uint8_t *y_plane{nullptr}; // Null when the image was decoded to RGB instead.
+    const uint8_t *u_plane{nullptr};
+    const uint8_t *v_plane{nullptr};
+    std::size_t y_stride{0};
+    std::size_t uv_stride{0};
+    int chroma_shift_x{0};
+    int chroma_shift_y{0};
+    yuv_conversion conversion;
+};
+
+// The bytes of one input file, valid while the object lives.
+// WHY mmap? The decoders read straight from the page cache: no allocation the size of the file,
+// no copy, and workers reading the same file share its pages. Pipes, special files and files that
+// cannot be mapped are read into `buffer` instead; either way the decoders see one span of bytes.
+struct input_file {
+    std::span<const uint8_t> bytes;
+    void *mapping{nullptr}; // The mmap() of the file, or null when it was read into `buffer`.
+    std::size_t mapping_size{0};
+    std::vector<uint8_t> buffer;
+
+    input_file() = default;
+    input_file(const input_file &) = delete;
+    input_file &operator=(const input_file &) = delete;
+    ~input_file();
+};
+
+// Opens `filename` and fills `file` with its contents. Prints an error and returns false on failure.
+bool open_input_file(std::string_view filename, input_file &file);
+
 // Decodes an image file specified by filename into an RGB pixel buffer.
-// Automatically detects format (AVIF, WebP, Other) and calls the appropriate decoder.
+// Automatically detects format (AVIF, WebP, JPEG, Other) and calls the appropriate decoder.
 // Returns a smart pointer managing the pixel buffer, or a null smart pointer on failure.
-// Updates width and height output parameters on success.
-smart_pixels_ptr decode_image(std::string_view filename, int &width, int &height);
+// Updates width and height output parameters on success (the decoded, possibly scaled, size).
+// When `yuv` is non-null and the decoder can hand out 8-bit YUV planes (AVIF, lossy WebP), fills *yuv instead
+// of converting to RGB; the returned pointer then points at the Y plane and owns all planes.
+smart_pixels_ptr decode_image(std::string_view filename, int &width, int &height, const decode_options &options = {},
+                              yuv_planes *yuv = nullptr);
+
+// Same as above for a file whose contents are already in memory (see read_ahead); `filename`
+// only labels error messages. The decoded pixels do not refer to `file_bytes`.
+smart_pixels_ptr decode_image(std::string_view filename, std::span<const uint8_t> file_bytes, int &width, int &height,
+                              const decode_options &options = {}, yuv_planes *yuv = nullptr);
+
+// Receives one band of a streamed image: `row_count` rows of packed RGB starting at row `first_row`.
+// Returns false when the rest of the image is not needed; decoding then stops.
+using band_consumer = std::move_only_function<bool(const uint8_t *rgb_rows, std::size_t first_row, std::size_t row_count)>;
+
+// How decode_image_bands() ended.
+enum class band_status {
+    COMPLETE,    // Every row was handed to the consumer.
+    STOPPED,     // The consumer returned false.
+    FAILED,      // The file broke off after some bands were delivered; an error was printed.
+    UNSUPPORTED, // Nothing was delivered; decode the image with decode_image() instead.
+};
+
+// Decodes an image larger than options.band_bytes band by band and hands each band to `consume`
+// as soon as it is decoded, so it is classified while still in cache.
+// JPEG: only one band is ever in memory, whatever the image size.
+// WebP: libwebp's incremental decoder needs a whole-image output buffer, so memory is not bounded,
+// but classification follows the decoder and can stop it early. Lossy WebP is left to decode_image()
+// when `yuv_wanted`, since its YUV planes take half the memory of RGB.
+// Other formats are UNSUPPORTED: libavif decodes grid images whole and stb_image has no row API.
+// `width` and `height` are set before the first band.
+band_status decode_image_bands(std::string_view filename, std::span<const uint8_t> file_bytes, int &width, int &height,
+                               const decode_options &options, bool yuv_wanted, band_consumer consume);
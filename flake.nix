@@ -30,6 +30,8 @@
         buildInputs = with pkgs; [
           libavif
           libwebp
+          libjpeg
+          liburing
         ];
 
         preBuild = ''
@@ -39,7 +41,7 @@
 
         buildPhase = ''
           runHook preBuild
-          make
+          make IO_URING=1
           runHook postBuild
         '';
 
@@ -57,6 +59,8 @@
               gcc
               libavif
               libwebp
+              libjpeg
+              liburing
               cli11
               clang-tools
             ]
@@ -74,8 +78,8 @@
           mkdir -p include
           ln -sf ${stb}/stb_image.h include/
 
-          export CPPFLAGS="$CPPFLAGS -Iinclude -I${pkgs.libavif}/include -I${pkgs.libwebp}/include -I${pkgs.cli11}/include"
-          export LDFLAGS="$LDFLAGS -L${pkgs.libavif.out}/lib -L${pkgs.libwebp.out}/lib"
+          export CPPFLAGS="$CPPFLAGS -Iinclude -I${pkgs.libavif}/include -I${pkgs.libwebp}/include -I${pkgs.libjpeg.dev}/include -I${pkgs.liburing.dev}/include -I${pkgs.cli11}/include"
+          export LDFLAGS="$LDFLAGS -L${pkgs.libavif.out}/lib -L${pkgs.libwebp.out}/lib -L${pkgs.libjpeg.out}/lib -L${pkgs.liburing}/lib"
         '';
       };
     };
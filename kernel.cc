@@ -0,0 +1,953 @@
+#include "kernel.hh"
+
+#include <atomic>
+#include <cstring>     // WHY: memcpy for unaligned 4-byte chroma loads.
+#include <tuple>       // WHY: The per-resolution LUT kernels of a kernel_set.
+#include <immintrin.h> // WHY: SSE/AVX intrinsics; each kernel opts in with a target attribute.
+
+// WHY static_assert? The SIMD kernels index each block LUT as one flat array of Blocks * Blocks entries.
+static_assert(sizeof(chroma_lut<64>) == 64 * 64 * sizeof(uint16_t), "chroma_lut must be a flat array");
+static_assert(sizeof(chroma_lut<128>) == 128 * 128 * sizeof(uint16_t), "chroma_lut must be a flat array");
+static_assert(sizeof(chroma_lut<256>) == 256 * 256 * sizeof(uint16_t), "chroma_lut must be a flat array");
+
+// The scalar kernel. With Lazy, `chroma_check_lut` comes from get_lazy_chroma_lut(): each entry is
+// loaded atomically and a CHROMA_LUT_UNKNOWN one is filled first. The SIMD kernels below take the
+// same parameter.
+// WHY a template parameter instead of always testing? The test costs complete tables (presets,
+// --lut-file) 10-15% of their throughput; the kernels pick the variant once per call.
+template <std::size_t Blocks, bool Lazy>
+static std::size_t count_lut_colored_scalar(const uint8_t *rgb_pixels, const std::size_t pixel_count,
+                                            const chroma_lut<Blocks> &chroma_check_lut)
+{
+    std::size_t colored_pixel_count{0};
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+        // Assuming RGB layout: R=pix[3*i], G=pix[3*i+1], B=pix[3*i+2]
+        const uint8_t r{rgb_pixels[3 * i + 0]};
+        const uint8_t g{rgb_pixels[3 * i + 1]};
+        const uint8_t b{rgb_pixels[3 * i + 2]};
+
+        // --- Chroma Check using LUT ---
+        // WHY bit shifts? Divides R and G by the block size (4 for the 64x64 LUT) to get the index
+        // of their block; one entry covers all (R,G) pairs of the block.
+        const int R_block{r >> rg_block_shift<Blocks>};
+        const int G_block{g >> rg_block_shift<Blocks>};
+        uint16_t min_max_b_packed;
+        if constexpr (Lazy) {
+            min_max_b_packed = load_chroma_lut_entry(chroma_check_lut, R_block, G_block);
+            if (min_max_b_packed == CHROMA_LUT_UNKNOWN) [[unlikely]]
+                min_max_b_packed = fill_chroma_lut_entry(chroma_check_lut, R_block, G_block);
+        } else {
+            min_max_b_packed = chroma_check_lut[R_block][G_block];
+        }
+        // WHY bit shifts and masking? Extracts the precomputed min/max B values
+        // packed into the uint16_t for the given R,G block.
+        const uint8_t min_b_for_gray{static_cast<uint8_t>(min_max_b_packed >> 8)};   // High byte
+        const uint8_t max_b_for_gray{static_cast<uint8_t>(min_max_b_packed & 0xff)}; // Low byte
+
+        // WHY check range? If B is outside the precomputed [min, max] range for this R,G block,
+        // the pixel's chroma MUST exceed the threshold used to generate the LUT. This is the
+        // core optimization - avoids expensive chroma calculation for most pixels.
+        if (b < min_b_for_gray || b > max_b_for_gray) {
+            colored_pixel_count++;
+        }
+    }
+    return colored_pixel_count;
+}
+
+template <std::size_t Blocks>
+std::size_t count_colored_pixels_scalar(const uint8_t *rgb_pixels, const std::size_t pixel_count,
+                                        const chroma_lut<Blocks> &chroma_check_lut)
+{
+    if (is_lazy_chroma_lut(chroma_check_lut))
+        return count_lut_colored_scalar<Blocks, true>(rgb_pixels, pixel_count, chroma_check_lut);
+    return count_lut_colored_scalar<Blocks, false>(rgb_pixels, pixel_count, chroma_check_lut);
+}
+
+// Fills the CHROMA_LUT_UNKNOWN entries that `pixel_count` pixels need; the Lazy SIMD kernels call
+// it when a load or gather returns one, then load again.
+// WHY out of line and cold? It runs at most once per block of a lazy table, so it should not
+// take registers or code size from the hot loops.
+// WHY may the kernels read entries another worker is storing? The scalar and SSE4.2 loads go
+// through load_chroma_lut_entry(), an atomic load. The AVX2 and AVX-512 gathers have no atomic
+// form; they rely on x86 never tearing a 2-byte-aligned 16-bit store, which each entry in a
+// gathered dword is, so they see either CHROMA_LUT_UNKNOWN or the final entry.
+template <std::size_t Blocks>
+[[gnu::noinline, gnu::cold]] static void fill_chroma_lut_entries(const uint8_t *pixels, const std::size_t pixel_count,
+                                                                 const chroma_lut<Blocks> &chroma_check_lut)
+{
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+        const int R_block{pixels[3 * i + 0] >> rg_block_shift<Blocks>};
+        const int G_block{pixels[3 * i + 1] >> rg_block_shift<Blocks>};
+        if (load_chroma_lut_entry(chroma_check_lut, R_block, G_block) == CHROMA_LUT_UNKNOWN)
+            fill_chroma_lut_entry(chroma_check_lut, R_block, G_block);
+    }
+}
+
+// The LUT entry at index R_block * Blocks + G_block. With Lazy, an atomic load, as another
+// worker may be filling the entry (the same movzx on x86).
+template <std::size_t Blocks, bool Lazy> static inline uint16_t lut_entry_at(const chroma_lut<Blocks> &lut, const int lut_index)
+{
+    if constexpr (Lazy)
+        return load_chroma_lut_entry(lut, static_cast<std::size_t>(lut_index));
+    return lut.data()->data()[lut_index];
+}
+
+// The LUT entries at the four indices, one per 32-bit lane.
+// WHY scalar loads? SSE has no gather; four extracts and loads are still cheaper than unpacking
+// and branching per pixel.
+template <std::size_t Blocks, bool Lazy>
+__attribute__((target("sse4.2"))) static inline __m128i load_lut_entries_sse42(const chroma_lut<Blocks> &lut, const __m128i lut_index)
+{
+    return _mm_setr_epi32(lut_entry_at<Blocks, Lazy>(lut, _mm_extract_epi32(lut_index, 0)),
+                          lut_entry_at<Blocks, Lazy>(lut, _mm_extract_epi32(lut_index, 1)),
+                          lut_entry_at<Blocks, Lazy>(lut, _mm_extract_epi32(lut_index, 2)),
+                          lut_entry_at<Blocks, Lazy>(lut, _mm_extract_epi32(lut_index, 3)));
+}
+
+// Classifies 4 pixels (12 bytes starting at `pixels`) and returns -1 in each colored lane, 0 elsewhere.
+// Reads 16 bytes: the caller must guarantee 4 readable bytes past the 4th pixel.
+template <std::size_t Blocks, bool Lazy>
+__attribute__((target("sse4.2"))) static inline __m128i classify_4_pixels_sse42(const uint8_t *pixels,
+                                                                                const chroma_lut<Blocks> &chroma_check_lut)
+{
+    // Spread each 3-byte pixel into its own 32-bit lane: R in bits 0-7, G in 8-15, B in 16-23.
+    const __m128i spread_pixels{_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)};
+    const __m128i px{_mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels)), spread_pixels)};
+
+    // LUT index = (R >> shift) * Blocks + (G >> shift), the same entry the scalar kernel reads.
+    constexpr int shift{rg_block_shift<Blocks>};
+    const __m128i block_mask{_mm_set1_epi32(Blocks - 1)};
+    const __m128i r_block{_mm_and_si128(_mm_srli_epi32(px, shift), block_mask)};
+    const __m128i g_block{_mm_and_si128(_mm_srli_epi32(px, 8 + shift), block_mask)};
+    const __m128i lut_index{_mm_or_si128(_mm_slli_epi32(r_block, 8 - shift), g_block)};
+
+    __m128i packed{load_lut_entries_sse42<Blocks, Lazy>(chroma_check_lut, lut_index)};
+    // WHY one test for all four lanes? A warm table then costs a compare per 4 pixels besides the loads.
+    if (Lazy && _mm_movemask_epi8(_mm_cmpeq_epi32(packed, _mm_set1_epi32(CHROMA_LUT_UNKNOWN))) != 0) [[unlikely]] {
+        fill_chroma_lut_entries<Blocks>(pixels, 4, chroma_check_lut);
+        packed = load_lut_entries_sse42<Blocks, Lazy>(chroma_check_lut, lut_index);
+    }
+
+    const __m128i byte_mask{_mm_set1_epi32(0xff)};
+    const __m128i min_b{_mm_and_si128(_mm_srli_epi32(packed, 8), byte_mask)};
+    const __m128i max_b{_mm_and_si128(packed, byte_mask)};
+    const __m128i b{_mm_srli_epi32(px, 16)};
+
+    // WHY signed 32-bit compares? All operands are in [0, 255], so signed order equals unsigned order.
+    return _mm_or_si128(_mm_cmpgt_epi32(min_b, b), _mm_cmpgt_epi32(b, max_b));
+}
+
+template <std::size_t Blocks, bool Lazy>
+__attribute__((target("sse4.2"))) static std::size_t
+count_lut_colored_sse42(const uint8_t *rgb_pixels, const std::size_t pixel_count, const chroma_lut<Blocks> &chroma_check_lut)
+{
+    std::size_t colored_pixel_count{0};
+    std::size_t i{0};
+
+    // WHY stop 18 pixels early? Each 16-pixel step reads 4 bytes past its last pixel; keeping two
+    // spare pixels (6 bytes) behind the loop guarantees those reads stay inside the buffer.
+    while (i + 18 <= pixel_count) {
+        // WHY flush every 2^20 steps? The per-lane 32-bit counters gain at most 4 per step,
+        // so they are folded into the size_t total long before they could overflow.
+        std::size_t steps_left{std::size_t{1} << 20};
+        __m128i lane_counts{_mm_setzero_si128()};
+        for (; i + 18 <= pixel_count && steps_left; i += 16, --steps_left) {
+            const uint8_t *p{rgb_pixels + 3 * i};
+            lane_counts = _mm_sub_epi32(lane_counts, classify_4_pixels_sse42<Blocks, Lazy>(p, chroma_check_lut));
+            lane_counts = _mm_sub_epi32(lane_counts, classify_4_pixels_sse42<Blocks, Lazy>(p + 12, chroma_check_lut));
+            lane_counts = _mm_sub_epi32(lane_counts, classify_4_pixels_sse42<Blocks, Lazy>(p + 24, chroma_check_lut));
+            lane_counts = _mm_sub_epi32(lane_counts, classify_4_pixels_sse42<Blocks, Lazy>(p + 36, chroma_check_lut));
+        }
+
+        // Horizontal sum of the four lane counters.
+        const __m128i pairs{_mm_add_epi32(lane_counts, _mm_shuffle_epi32(lane_counts, _MM_SHUFFLE(1, 0, 3, 2)))};
+        const __m128i total{_mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, _MM_SHUFFLE(2, 3, 0, 1)))};
+        colored_pixel_count += static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+    }
+
+    // Remaining pixels go through the scalar kernel.
+    return colored_pixel_count + count_lut_colored_scalar<Blocks, Lazy>(rgb_pixels + 3 * i, pixel_count - i, chroma_check_lut);
+}
+
+template <std::size_t Blocks>
+__attribute__((target("sse4.2"))) std::size_t count_colored_pixels_sse42(const uint8_t *rgb_pixels, const std::size_t pixel_count,
+                                                                         const chroma_lut<Blocks> &chroma_check_lut)
+{
+    if (is_lazy_chroma_lut(chroma_check_lut))
+        return count_lut_colored_sse42<Blocks, true>(rgb_pixels, pixel_count, chroma_check_lut);
+    return count_lut_colored_sse42<Blocks, false>(rgb_pixels, pixel_count, chroma_check_lut);
+}
+
+// The LUT entries at the eight indices in the low half of each 32-bit lane.
+// WHY gather 32-bit words at index / 2? There is no 16-bit gather. Reading the aligned pair that
+// holds the entry never touches memory outside the table; a shift then selects the half we need
+// (even entries are the low half on little-endian x86).
+__attribute__((target("avx2"))) static inline __m256i gather_lut_entries_avx2(const int *lut_words, const __m256i lut_index)
+{
+    const __m256i pair{_mm256_i32gather_epi32(lut_words, _mm256_srli_epi32(lut_index, 1), 4)};
+    const __m256i half_shift{_mm256_slli_epi32(_mm256_and_si256(lut_index, _mm256_set1_epi32(1)), 4)};
+    return _mm256_srlv_epi32(pair, half_shift);
+}
+
+// Classifies 8 pixels (24 bytes starting at `pixels`) and returns -1 in each colored lane, 0 elsewhere.
+// Reads 28 bytes: the caller must guarantee 4 readable bytes past the 8th pixel.
+template <std::size_t Blocks, bool Lazy>
+__attribute__((target("avx2"))) static inline __m256i classify_8_pixels_avx2(const uint8_t *pixels,
+                                                                             const chroma_lut<Blocks> &chroma_check_lut)
+{
+    const int *lut_words{reinterpret_cast<const int *>(chroma_check_lut.data())};
+
+    // WHY two 16-byte loads at +0 and +12? Puts pixels 0-3 in the low 128-bit lane and pixels 4-7
+    // in the high lane, so the in-lane byte shuffle below can deinterleave all eight at once.
+    const __m256i raw{_mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 12)), 1)};
+
+    // Spread each 3-byte pixel into its own 32-bit lane: R in bits 0-7, G in 8-15, B in 16-23.
+    const __m256i spread_pixels{_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, //
+                                                 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)};
+    const __m256i px{_mm256_shuffle_epi8(raw, spread_pixels)};
+
+    // LUT index = (R >> shift) * Blocks + (G >> shift), the same entry the scalar kernel reads.
+    constexpr int shift{rg_block_shift<Blocks>};
+    const __m256i block_mask{_mm256_set1_epi32(Blocks - 1)};
+    const __m256i r_block{_mm256_and_si256(_mm256_srli_epi32(px, shift), block_mask)};
+    const __m256i g_block{_mm256_and_si256(_mm256_srli_epi32(px, 8 + shift), block_mask)};
+    const __m256i lut_index{_mm256_or_si256(_mm256_slli_epi32(r_block, 8 - shift), g_block)};
+
+    __m256i packed{gather_lut_entries_avx2(lut_words, lut_index)};
+    if constexpr (Lazy) {
+        // WHY compare 16-bit halves? The upper half of a lane may hold the neighbouring entry.
+        const __m256i unknown{_mm256_cmpeq_epi16(packed, _mm256_set1_epi32(CHROMA_LUT_UNKNOWN))};
+        if (!_mm256_testz_si256(unknown, _mm256_set1_epi32(0xffff))) [[unlikely]] {
+            fill_chroma_lut_entries<Blocks>(pixels, 8, chroma_check_lut);
+            packed = gather_lut_entries_avx2(lut_words, lut_index);
+        }
+    }
+
+    const __m256i byte_mask{_mm256_set1_epi32(0xff)};
+    const __m256i min_b{_mm256_and_si256(_mm256_srli_epi32(packed, 8), byte_mask)};
+    const __m256i max_b{_mm256_and_si256(packed, byte_mask)};
+    const __m256i b{_mm256_srli_epi32(px, 16)};
+
+    // WHY signed 32-bit compares? All operands are in [0, 255], so signed order equals unsigned order.
+    return _mm256_or_si256(_mm256_cmpgt_epi32(min_b, b), _mm256_cmpgt_epi32(b, max_b));
+}
+
+template <std::size_t Blocks, bool Lazy>
+__attribute__((target("avx2"))) static std::size_t count_lut_colored_avx2(const uint8_t *rgb_pixels, const std::size_t pixel_count,
+                                                                          const chroma_lut<Blocks> &chroma_check_lut)
+{
+    std::size_t colored_pixel_count{0};
+    std::size_t i{0};
+
+    // WHY stop 34 pixels early? Each 32-pixel step reads 4 bytes past its last pixel; keeping two
+    // spare pixels (6 bytes) behind the loop guarantees those reads stay inside the buffer.
+    while (i + 34 <= pixel_count) {
+        // WHY flush every 2^20 steps? The per-lane 32-bit counters gain at most 4 per step,
+        // so they are folded into the size_t total long before they could overflow.
+        std::size_t steps_left{std::size_t{1} << 20};
+        __m256i lane_counts{_mm256_setzero_si256()};
+        for (; i + 34 <= pixel_count && steps_left; i += 32, --steps_left) {
+            const uint8_t *p{rgb_pixels + 3 * i};
+            // WHY subtract? Colored lanes are -1, so subtracting the mask adds one per colored pixel
+            // without any branch.
+            lane_counts = _mm256_sub_epi32(lane_counts, classify_8_pixels_avx2<Blocks, Lazy>(p, chroma_check_lut));
+            lane_counts = _mm256_sub_epi32(lane_counts, classify_8_pixels_avx2<Blocks, Lazy>(p + 24, chroma_check_lut));
+            lane_counts = _mm256_sub_epi32(lane_counts, classify_8_pixels_avx2<Blocks, Lazy>(p + 48, chroma_check_lut));
+            lane_counts = _mm256_sub_epi32(lane_counts, classify_8_pixels_avx2<Blocks, Lazy>(p + 72, chroma_check_lut));
+        }
+
+        // Horizontal sum of the eight lane counters.
+        const __m128i folded{_mm_add_epi32(_mm256_castsi256_si128(lane_counts), _mm256_extracti128_si256(lane_counts, 1))};
+        const __m128i pairs{_mm_add_epi32(folded, _mm_shuffle_epi32(folded, _MM_SHUFFLE(1, 0, 3, 2)))};
+        const __m128i total{_mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, _MM_SHUFFLE(2, 3, 0, 1)))};
+        colored_pixel_count += static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+    }
+
+    // Remaining pixels go through the scalar kernel.
+    return colored_pixel_count + count_lut_colored_scalar<Blocks, Lazy>(rgb_pixels + 3 * i, pixel_count - i, chroma_check_lut);
+}
+
+template <std::size_t Blocks>
+__attribute__((target("avx2"))) std::size_t count_colored_pixels_avx2(const uint8_t *rgb_pixels, const std::size_t pixel_count,
+                                                                      const chroma_lut<Blocks> &chroma_check_lut)
+{
+    if (is_lazy_chroma_lut(chroma_check_lut))
+        return count_lut_colored_avx2<Blocks, true>(rgb_pixels, pixel_count, chroma_check_lut);
+    return count_lut_colored_avx2<Blocks, false>(rgb_pixels, pixel_count, chroma_check_lut);
+}
+
+// Same aligned-pair gather as gather_lut_entries_avx2, for sixteen indices.
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i gather_lut_entries_avx512(const int *lut_words,
+                                                                                           const __m512i lut_index)
+{
+    const __m512i pair{_mm512_i32gather_epi32(_mm512_srli_epi32(lut_index, 1), lut_words, 4)};
+    const __m512i half_shift{_mm512_slli_epi32(_mm512_and_si512(lut_index, _mm512_set1_epi32(1)), 4)};
+    return _mm512_srlv_epi32(pair, half_shift);
+}
+
+// Classifies 16 pixels (48 bytes starting at `pixels`) and returns a mask with one bit per colored pixel.
+// Reads 52 bytes: the caller must guarantee 4 readable bytes past the 16th pixel.
+template <std::size_t Blocks, bool Lazy>
+__attribute__((target("avx512f,avx512bw"))) static inline __mmask16
+classify_16_pixels_avx512(const uint8_t *pixels, const chroma_lut<Blocks> &chroma_check_lut)
+{
+    const int *lut_words{reinterpret_cast<const int *>(chroma_check_lut.data())};
+
+    // WHY four 16-byte loads 12 bytes apart? Each 128-bit lane receives 4 whole pixels, so the
+    // in-lane byte shuffle (AVX512BW) can deinterleave all sixteen at once.
+    __m512i raw{_mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels)))};
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 12)), 1);
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 24)), 2);
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 36)), 3);
+
+    // Spread each 3-byte pixel into its own 32-bit lane: R in bits 0-7, G in 8-15, B in 16-23.
+    const __m512i spread_pixels{_mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1))};
+    const __m512i px{_mm512_shuffle_epi8(raw, spread_pixels)};
+
+    // LUT index = (R >> shift) * Blocks + (G >> shift), the same entry the scalar kernel reads.
+    constexpr int shift{rg_block_shift<Blocks>};
+    const __m512i block_mask{_mm512_set1_epi32(Blocks - 1)};
+    const __m512i r_block{_mm512_and_si512(_mm512_srli_epi32(px, shift), block_mask)};
+    const __m512i g_block{_mm512_and_si512(_mm512_srli_epi32(px, 8 + shift), block_mask)};
+    const __m512i lut_index{_mm512_or_si512(_mm512_slli_epi32(r_block, 8 - shift), g_block)};
+
+    __m512i packed{gather_lut_entries_avx512(lut_words, lut_index)};
+    // WHY only the even 16-bit halves? The odd ones may hold neighbouring entries (see gather_lut_entries_avx2).
+    if (Lazy && _mm512_mask_cmpeq_epi16_mask(0x55555555, packed, _mm512_set1_epi32(CHROMA_LUT_UNKNOWN)) != 0) [[unlikely]] {
+        fill_chroma_lut_entries<Blocks>(pixels, 16, chroma_check_lut);
+        packed = gather_lut_entries_avx512(lut_words, lut_index);
+    }
+
+    const __m512i byte_mask{_mm512_set1_epi32(0xff)};
+    const __m512i min_b{_mm512_and_si512(_mm512_srli_epi32(packed, 8), byte_mask)};
+    const __m512i max_b{_mm512_and_si512(packed, byte_mask)};
+    const __m512i b{_mm512_srli_epi32(px, 16)};
+
+    return _mm512_cmpgt_epi32_mask(min_b, b) | _mm512_cmpgt_epi32_mask(b, max_b);
+}
+
+template <std::size_t Blocks, bool Lazy>
+__attribute__((target("avx512f,avx512bw,popcnt"))) static std::size_t
+count_lut_colored_avx512(const uint8_t *rgb_pixels, const std::size_t pixel_count, const chroma_lut<Blocks> &chroma_check_lut)
+{
+    std::size_t colored_pixel_count{0};
+    std::size_t i{0};
+
+    // WHY stop 66 pixels early? Each 64-pixel step reads 4 bytes past its last pixel; keeping two
+    // spare pixels (6 bytes) behind the loop guarantees those reads stay inside the buffer.
+    for (; i + 66 <= pixel_count; i += 64) {
+        const uint8_t *p{rgb_pixels + 3 * i};
+        // WHY pack four masks into 64 bits? One popcount then counts all 64 pixels of the step.
+        const chroma_lut<Blocks> &lut{chroma_check_lut};
+        const uint64_t colored_bits{static_cast<uint64_t>(classify_16_pixels_avx512<Blocks, Lazy>(p, lut)) |
+                                    static_cast<uint64_t>(classify_16_pixels_avx512<Blocks, Lazy>(p + 48, lut)) << 16 |
+                                    static_cast<uint64_t>(classify_16_pixels_avx512<Blocks, Lazy>(p + 96, lut)) << 32 |
+                                    static_cast<uint64_t>(classify_16_pixels_avx512<Blocks, Lazy>(p + 144, lut)) << 48};
+        colored_pixel_count += static_cast<std::size_t>(_mm_popcnt_u64(colored_bits));
+    }
+
+    // Remaining pixels go through the scalar kernel.
+    return colored_pixel_count + count_lut_colored_scalar<Blocks, Lazy>(rgb_pixels + 3 * i, pixel_count - i, chroma_check_lut);
+}
+
+template <std::size_t Blocks>
+__attribute__((target("avx512f,avx512bw,popcnt"))) std::size_t
+count_colored_pixels_avx512(const uint8_t *rgb_pixels, const std::size_t pixel_count, const chroma_lut<Blocks> &chroma_check_lut)
+{
+    if (is_lazy_chroma_lut(chroma_check_lut))
+        return count_lut_colored_avx512<Blocks, true>(rgb_pixels, pixel_count, chroma_check_lut);
+    return count_lut_colored_avx512<Blocks, false>(rgb_pixels, pixel_count, chroma_check_lut);
+}
+
+// The resolutions chroma_lut_ref can hold.
+template std::size_t count_colored_pixels_scalar<64>(const uint8_t *, std::size_t, const chroma_lut<64> &);
+template std::size_t count_colored_pixels_scalar<128>(const uint8_t *, std::size_t, const chroma_lut<128> &);
+template std::size_t count_colored_pixels_scalar<256>(const uint8_t *, std::size_t, const chroma_lut<256> &);
+template std::size_t count_colored_pixels_sse42<64>(const uint8_t *, std::size_t, const chroma_lut<64> &);
+template std::size_t count_colored_pixels_sse42<128>(const uint8_t *, std::size_t, const chroma_lut<128> &);
+template std::size_t count_colored_pixels_sse42<256>(const uint8_t *, std::size_t, const chroma_lut<256> &);
+template std::size_t count_colored_pixels_avx2<64>(const uint8_t *, std::size_t, const chroma_lut<64> &);
+template std::size_t count_colored_pixels_avx2<128>(const uint8_t *, std::size_t, const chroma_lut<128> &);
+template std::size_t count_colored_pixels_avx2<256>(const uint8_t *, std::size_t, const chroma_lut<256> &);
+template std::size_t count_colored_pixels_avx512<64>(const uint8_t *, std::size_t, const chroma_lut<64> &);
+template std::size_t count_colored_pixels_avx512<128>(const uint8_t *, std::size_t, const chroma_lut<128> &);
+template std::size_t count_colored_pixels_avx512<256>(const uint8_t *, std::size_t, const chroma_lut<256> &);
+
+std::size_t count_colored_pixels_exact_scalar(const uint8_t *rgb_pixels, const std::size_t pixel_count,
+                                              const chroma_bitset_t &chroma_bits)
+{
+    std::size_t colored_pixel_count{0};
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+        // WHY R | G << 8 | B << 16? Bit layout of chroma_bitset_t (see lut.hh).
+        const uint32_t bit_index{static_cast<uint32_t>(rgb_pixels[3 * i + 0] | rgb_pixels[3 * i + 1] << 8 |
+                                                       rgb_pixels[3 * i + 2] << 16)};
+        // WHY add the bit? The set bit already means "colored", so counting needs no branch.
+        colored_pixel_count += (chroma_bits[bit_index >> 6] >> (bit_index & 63)) & 1;
+    }
+    return colored_pixel_count;
+}
+
+__attribute__((target("sse4.2"))) std::size_t count_colored_pixels_exact_sse42(const uint8_t *rgb_pixels,
+                                                                               const std::size_t pixel_count,
+                                                                               const chroma_bitset_t &chroma_bits)
+{
+    const uint32_t *bit_words{reinterpret_cast<const uint32_t *>(chroma_bits.data())};
+    const __m128i spread_pixels{_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)};
+
+    std::size_t colored_pixel_count{0};
+    std::size_t i{0};
+    // WHY stop 6 pixels early? Each 4-pixel load reads 4 bytes past its last pixel (see the LUT kernel).
+    for (; i + 6 <= pixel_count; i += 4) {
+        // Widened pixels are the bit indices (R | G << 8 | B << 16).
+        const __m128i bit_index{
+            _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rgb_pixels + 3 * i)), spread_pixels)};
+        // WHY scalar loads? SSE has no gather; 32-bit words halve the shift width compared to uint64_t.
+        alignas(16) uint32_t indices[4];
+        _mm_store_si128(reinterpret_cast<__m128i *>(indices), bit_index);
+        for (const uint32_t index : indices) {
+            colored_pixel_count += (bit_words[index >> 5] >> (index & 31)) & 1;
+        }
+    }
+    return colored_pixel_count + count_colored_pixels_exact_scalar(rgb_pixels + 3 * i, pixel_count - i, chroma_bits);
+}
+
+// Returns 1 in each lane whose pixel is colored according to the exact bitset, 0 elsewhere.
+// Reads 28 bytes: the caller must guarantee 4 readable bytes past the 8th pixel.
+__attribute__((target("avx2"))) static inline __m256i classify_8_pixels_exact_avx2(const uint8_t *pixels, const int *bit_words)
+{
+    const __m256i raw{_mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 12)), 1)};
+    const __m256i spread_pixels{_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, //
+                                                 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)};
+    // Widened pixels are the bit indices (R | G << 8 | B << 16).
+    const __m256i bit_index{_mm256_shuffle_epi8(raw, spread_pixels)};
+
+    // One 32-bit gather per 8 pixels, then shift the wanted bit down to bit 0.
+    const __m256i words{_mm256_i32gather_epi32(bit_words, _mm256_srli_epi32(bit_index, 5), 4)};
+    const __m256i bits{_mm256_srlv_epi32(words, _mm256_and_si256(bit_index, _mm256_set1_epi32(31)))};
+    return _mm256_and_si256(bits, _mm256_set1_epi32(1));
+}
+
+__attribute__((target("avx2"))) std::size_t count_colored_pixels_exact_avx2(const uint8_t *rgb_pixels,
+                                                                            const std::size_t pixel_count,
+                                                                            const chroma_bitset_t &chroma_bits)
+{
+    const int *bit_words{reinterpret_cast<const int *>(chroma_bits.data())};
+
+    std::size_t colored_pixel_count{0};
+    std::size_t i{0};
+    // Same early stop and counter flushing as count_colored_pixels_avx2.
+    while (i + 34 <= pixel_count) {
+        std::size_t steps_left{std::size_t{1} << 20};
+        __m256i lane_counts{_mm256_setzero_si256()};
+        for (; i + 34 <= pixel_count && steps_left; i += 32, --steps_left) {
+            const uint8_t *p{rgb_pixels + 3 * i};
+            lane_counts = _mm256_add_epi32(lane_counts, classify_8_pixels_exact_avx2(p, bit_words));
+            lane_counts = _mm256_add_epi32(lane_counts, classify_8_pixels_exact_avx2(p + 24, bit_words));
+            lane_counts = _mm256_add_epi32(lane_counts, classify_8_pixels_exact_avx2(p + 48, bit_words));
+            lane_counts = _mm256_add_epi32(lane_counts, classify_8_pixels_exact_avx2(p + 72, bit_words));
+        }
+
+        const __m128i folded{_mm_add_epi32(_mm256_castsi256_si128(lane_counts), _mm256_extracti128_si256(lane_counts, 1))};
+        const __m128i pairs{_mm_add_epi32(folded, _mm_shuffle_epi32(folded, _MM_SHUFFLE(1, 0, 3, 2)))};
+        const __m128i total{_mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, _MM_SHUFFLE(2, 3, 0, 1)))};
+        colored_pixel_count += static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+    }
+    return colored_pixel_count + count_colored_pixels_exact_scalar(rgb_pixels + 3 * i, pixel_count - i, chroma_bits);
+}
+
+// Returns a mask with one bit per colored pixel according to the exact bitset.
+// Reads 52 bytes: the caller must guarantee 4 readable bytes past the 16th pixel.
+__attribute__((target("avx512f,avx512bw"))) static inline __mmask16 classify_16_pixels_exact_avx512(const uint8_t *pixels,
+                                                                                                    const int *bit_words)
+{
+    __m512i raw{_mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels)))};
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 12)), 1);
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 24)), 2);
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 36)), 3);
+    const __m512i spread_pixels{_mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1))};
+    // Widened pixels are the bit indices (R | G << 8 | B << 16).
+    const __m512i bit_index{_mm512_shuffle_epi8(raw, spread_pixels)};
+
+    const __m512i words{_mm512_i32gather_epi32(_mm512_srli_epi32(bit_index, 5), bit_words, 4)};
+    const __m512i bits{_mm512_srlv_epi32(words, _mm512_and_si512(bit_index, _mm512_set1_epi32(31)))};
+    return _mm512_test_epi32_mask(bits, _mm512_set1_epi32(1));
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt"))) std::size_t
+count_colored_pixels_exact_avx512(const uint8_t *rgb_pixels, const std::size_t pixel_count, const chroma_bitset_t &chroma_bits)
+{
+    const int *bit_words{reinterpret_cast<const int *>(chroma_bits.data())};
+
+    std::size_t colored_pixel_count{0};
+    std::size_t i{0};
+    // Same early stop and mask packing as count_colored_pixels_avx512.
+    for (; i + 66 <= pixel_count; i += 64) {
+        const uint8_t *p{rgb_pixels + 3 * i};
+        const uint64_t colored_bits{static_cast<uint64_t>(classify_16_pixels_exact_avx512(p, bit_words)) |
+                                    static_cast<uint64_t>(classify_16_pixels_exact_avx512(p + 48, bit_words)) << 16 |
+                                    static_cast<uint64_t>(classify_16_pixels_exact_avx512(p + 96, bit_words)) << 32 |
+                                    static_cast<uint64_t>(classify_16_pixels_exact_avx512(p + 144, bit_words)) << 48};
+        colored_pixel_count += static_cast<std::size_t>(_mm_popcnt_u64(colored_bits));
+    }
+    return colored_pixel_count + count_colored_pixels_exact_scalar(rgb_pixels + 3 * i, pixel_count - i, chroma_bits);
+}
+
+std::size_t count_colored_pixels_yuv_scalar(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row,
+                                            const std::size_t first_x, const std::size_t pixel_count, const int chroma_shift_x,
+                                            const chroma_bitset_t &yuv_bits)
+{
+    std::size_t colored_pixel_count{0};
+    for (std::size_t x = first_x; x < first_x + pixel_count; ++x) {
+        const std::size_t chroma_x{x >> chroma_shift_x};
+        // WHY Y | U << 8 | V << 16? Bit layout of get_yuv_chroma_bitset() (see lut.hh).
+        const uint32_t bit_index{static_cast<uint32_t>(y_row[x] | u_row[chroma_x] << 8 | v_row[chroma_x] << 16)};
+        colored_pixel_count += (yuv_bits[bit_index >> 6] >> (bit_index & 63)) & 1;
+    }
+    return colored_pixel_count;
+}
+
+// Loads the chroma samples of pixels x .. x+7 into 32-bit lanes. With subsampling x must be even.
+// Reads exactly the samples it returns, so no padding is needed after the row.
+__attribute__((target("avx2"))) static inline __m256i load_8_chroma_avx2(const uint8_t *chroma_row, const std::size_t x,
+                                                                         const int chroma_shift_x)
+{
+    if (chroma_shift_x == 0) {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(chroma_row + x)));
+    }
+    // 4 samples, each shared by two neighbouring pixels.
+    uint32_t samples;
+    std::memcpy(&samples, chroma_row + (x >> 1), sizeof(samples));
+    return _mm256_permutevar8x32_epi32(_mm256_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(samples))),
+                                       _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+}
+
+__attribute__((target("avx2"))) std::size_t count_colored_pixels_yuv_avx2(const uint8_t *y_row, const uint8_t *u_row,
+                                                                          const uint8_t *v_row, const std::size_t first_x,
+                                                                          const std::size_t pixel_count, const int chroma_shift_x,
+                                                                          const chroma_bitset_t &yuv_bits)
+{
+    const int *bit_words{reinterpret_cast<const int *>(yuv_bits.data())};
+    const std::size_t end_x{first_x + pixel_count};
+
+    std::size_t colored_pixel_count{0};
+    std::size_t x{first_x};
+    // WHY peel an odd first pixel? Vector steps must start on a pixel pair that shares one chroma sample.
+    if ((x & 1) && x < end_x) {
+        colored_pixel_count += count_colored_pixels_yuv_scalar(y_row, u_row, v_row, x, 1, chroma_shift_x, yuv_bits);
+        ++x;
+    }
+
+    // WHY no counter flushing? A lane gains at most one per 8 pixels of a single row.
+    __m256i lane_counts{_mm256_setzero_si256()};
+    for (; x + 8 <= end_x; x += 8) {
+        const __m256i y{_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y_row + x)))};
+        const __m256i u{load_8_chroma_avx2(u_row, x, chroma_shift_x)};
+        const __m256i v{load_8_chroma_avx2(v_row, x, chroma_shift_x)};
+        const __m256i bit_index{_mm256_or_si256(y, _mm256_or_si256(_mm256_slli_epi32(u, 8), _mm256_slli_epi32(v, 16)))};
+
+        // Same gather and bit extraction as classify_8_pixels_exact_avx2.
+        const __m256i words{_mm256_i32gather_epi32(bit_words, _mm256_srli_epi32(bit_index, 5), 4)};
+        const __m256i bits{_mm256_srlv_epi32(words, _mm256_and_si256(bit_index, _mm256_set1_epi32(31)))};
+        lane_counts = _mm256_add_epi32(lane_counts, _mm256_and_si256(bits, _mm256_set1_epi32(1)));
+    }
+
+    const __m128i folded{_mm_add_epi32(_mm256_castsi256_si128(lane_counts), _mm256_extracti128_si256(lane_counts, 1))};
+    const __m128i pairs{_mm_add_epi32(folded, _mm_shuffle_epi32(folded, _MM_SHUFFLE(1, 0, 3, 2)))};
+    const __m128i total{_mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, _MM_SHUFFLE(2, 3, 0, 1)))};
+    colored_pixel_count += static_cast<uint32_t>(_mm_cvtsi128_si32(total));
+
+    return colored_pixel_count + count_colored_pixels_yuv_scalar(y_row, u_row, v_row, x, end_x - x, chroma_shift_x, yuv_bits);
+}
+
+// Loads the chroma samples of pixels x .. x+15 into 32-bit lanes. With subsampling x must be even.
+__attribute__((target("avx512f,avx512bw"))) static inline __m512i load_16_chroma_avx512(const uint8_t *chroma_row,
+                                                                                       const std::size_t x,
+                                                                                       const int chroma_shift_x)
+{
+    if (chroma_shift_x == 0) {
+        return _mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(chroma_row + x)));
+    }
+    // 8 samples, each shared by two neighbouring pixels.
+    const __m256i samples{_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(chroma_row + (x >> 1))))};
+    return _mm512_permutexvar_epi32(_mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7),
+                                    _mm512_castsi256_si512(samples));
+}
+
+__attribute__((target("avx512f,avx512bw,popcnt"))) std::size_t
+count_colored_pixels_yuv_avx512(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row, const std::size_t first_x,
+                                const std::size_t pixel_count, const int chroma_shift_x, const chroma_bitset_t &yuv_bits)
+{
+    const int *bit_words{reinterpret_cast<const int *>(yuv_bits.data())};
+    const std::size_t end_x{first_x + pixel_count};
+
+    std::size_t colored_pixel_count{0};
+    std::size_t x{first_x};
+    // Same odd-pixel peeling as count_colored_pixels_yuv_avx2.
+    if ((x & 1) && x < end_x) {
+        colored_pixel_count += count_colored_pixels_yuv_scalar(y_row, u_row, v_row, x, 1, chroma_shift_x, yuv_bits);
+        ++x;
+    }
+
+    for (; x + 16 <= end_x; x += 16) {
+        const __m512i y{_mm512_cvtepu8_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(y_row + x)))};
+        const __m512i u{load_16_chroma_avx512(u_row, x, chroma_shift_x)};
+        const __m512i v{load_16_chroma_avx512(v_row, x, chroma_shift_x)};
+        const __m512i bit_index{_mm512_or_si512(y, _mm512_or_si512(_mm512_slli_epi32(u, 8), _mm512_slli_epi32(v, 16)))};
+
+        const __m512i words{_mm512_i32gather_epi32(_mm512_srli_epi32(bit_index, 5), bit_words, 4)};
+        const __m512i bits{_mm512_srlv_epi32(words, _mm512_and_si512(bit_index, _mm512_set1_epi32(31)))};
+        colored_pixel_count += static_cast<std::size_t>(_mm_popcnt_u32(_mm512_test_epi32_mask(bits, _mm512_set1_epi32(1))));
+    }
+    return colored_pixel_count + count_colored_pixels_yuv_scalar(y_row, u_row, v_row, x, end_x - x, chroma_shift_x, yuv_bits);
+}
+
+// Scalar max-chroma reduction over compute_chroma_squared().
+static float max_chroma_squared_scalar(const uint8_t *rgb_pixels, const std::size_t pixel_count)
+{
+    // WHY squared? Avoids sqrt until the very end for performance.
+    float max_chroma_squared{0.f};
+    for (std::size_t i = 0; i < pixel_count; ++i) {
+        const float current_chroma_squared{
+            compute_chroma_squared(rgb_pixels[3 * i + 0], rgb_pixels[3 * i + 1], rgb_pixels[3 * i + 2])};
+        if (current_chroma_squared > max_chroma_squared) {
+            max_chroma_squared = current_chroma_squared;
+        }
+    }
+    return max_chroma_squared;
+}
+
+// --- Vectorized Max Chroma ---
+// The SIMD max-chroma kernels evaluate the same formula as compute_chroma_squared(): gather the
+// per-channel XYZ contributions from srgb_to_xyz, sum them in the same order, apply the LAB transfer
+// function and return a*^2 + b*^2. Only the cube root differs: there is no vector cbrt, so it is
+// computed with an exponent-dividing bit trick (about 3% off) refined by three Newton steps
+// y = (2y + t / y^2) / 3, which converges to float rounding level.
+//
+// Accuracy, measured over all 2^24 RGB values: sqrt of the kernel's result differs from
+// compute_chroma() (double precision) by at most 1.3e-4 chroma units, and from the scalar float
+// path by at most 1.1e-4 (which itself is up to 1.0e-4 off compute_chroma()). Output is printed
+// with 3 decimals.
+
+// WHY 0x2a5137a0? Adding it to (float bits / 3) divides the exponent by 3 and re-biases it,
+// giving a first cube root estimate for positive normal floats.
+constexpr int cbrt_magic{0x2a5137a0};
+constexpr float xyz_epsilon{0.008856f}; // Same constants as f_xyz_transfer_float() in lut_generator.hh.
+constexpr float xyz_ratio{7.787f};
+constexpr float xyz_delta{16.0f / 116.0f};
+
+__attribute__((target("sse4.2"))) static inline __m128 xyz_transfer_sse42(const __m128 t)
+{
+    // WHY divide the bit pattern in float? SSE has no integer division; the estimate only needs
+    // a few correct bits before Newton refines it.
+    const __m128 third{_mm_set1_ps(1.f / 3.f)};
+    __m128 y{_mm_castsi128_ps(_mm_add_epi32(
+        _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(_mm_castps_si128(t)), third)), _mm_set1_epi32(cbrt_magic)))};
+    for (int step = 0; step < 3; ++step) {
+        y = _mm_mul_ps(_mm_add_ps(_mm_add_ps(y, y), _mm_div_ps(t, _mm_mul_ps(y, y))), third);
+    }
+    // WHY blend? Below epsilon the transfer function is linear, exactly as in the scalar path.
+    const __m128 linear{_mm_add_ps(_mm_mul_ps(_mm_set1_ps(xyz_ratio), t), _mm_set1_ps(xyz_delta))};
+    return _mm_blendv_ps(linear, y, _mm_cmpgt_ps(t, _mm_set1_ps(xyz_epsilon)));
+}
+
+__attribute__((target("sse4.2"))) static inline __m128 chroma_squared_4_pixels_sse42(const uint8_t *pixels)
+{
+    const srgb_to_xyz_tables &xyz{srgb_to_xyz};
+    // WHY scalar loads? SSE has no gather; the vector win here is the cube root and the arithmetic.
+    const uint8_t *p0{pixels}, *p1{pixels + 3}, *p2{pixels + 6}, *p3{pixels + 9};
+    const __m128 x{_mm_add_ps(_mm_add_ps(_mm_setr_ps(xyz.rx[p0[0]], xyz.rx[p1[0]], xyz.rx[p2[0]], xyz.rx[p3[0]]),
+                                         _mm_setr_ps(xyz.gx[p0[1]], xyz.gx[p1[1]], xyz.gx[p2[1]], xyz.gx[p3[1]])),
+                              _mm_setr_ps(xyz.bx[p0[2]], xyz.bx[p1[2]], xyz.bx[p2[2]], xyz.bx[p3[2]]))};
+    const __m128 y{_mm_add_ps(_mm_add_ps(_mm_setr_ps(xyz.ry[p0[0]], xyz.ry[p1[0]], xyz.ry[p2[0]], xyz.ry[p3[0]]),
+                                         _mm_setr_ps(xyz.gy[p0[1]], xyz.gy[p1[1]], xyz.gy[p2[1]], xyz.gy[p3[1]])),
+                              _mm_setr_ps(xyz.by[p0[2]], xyz.by[p1[2]], xyz.by[p2[2]], xyz.by[p3[2]]))};
+    const __m128 z{_mm_add_ps(_mm_add_ps(_mm_setr_ps(xyz.rz[p0[0]], xyz.rz[p1[0]], xyz.rz[p2[0]], xyz.rz[p3[0]]),
+                                         _mm_setr_ps(xyz.gz[p0[1]], xyz.gz[p1[1]], xyz.gz[p2[1]], xyz.gz[p3[1]])),
+                              _mm_setr_ps(xyz.bz[p0[2]], xyz.bz[p1[2]], xyz.bz[p2[2]], xyz.bz[p3[2]]))};
+
+    const __m128 fx{xyz_transfer_sse42(x)};
+    const __m128 fy{xyz_transfer_sse42(y)};
+    const __m128 fz{xyz_transfer_sse42(z)};
+    const __m128 a_star{_mm_mul_ps(_mm_set1_ps(500.0f), _mm_sub_ps(fx, fy))};
+    const __m128 b_star{_mm_mul_ps(_mm_set1_ps(200.0f), _mm_sub_ps(fy, fz))};
+    return _mm_add_ps(_mm_mul_ps(a_star, a_star), _mm_mul_ps(b_star, b_star));
+}
+
+__attribute__((target("sse4.2"))) static float max_chroma_squared_sse42(const uint8_t *rgb_pixels, const std::size_t pixel_count)
+{
+    __m128 max_vector{_mm_setzero_ps()};
+    std::size_t i{0};
+    for (; i + 4 <= pixel_count; i += 4) {
+        max_vector = _mm_max_ps(max_vector, chroma_squared_4_pixels_sse42(rgb_pixels + 3 * i));
+    }
+
+    // Horizontal max of the four lanes, then the scalar tail.
+    max_vector = _mm_max_ps(max_vector, _mm_shuffle_ps(max_vector, max_vector, _MM_SHUFFLE(1, 0, 3, 2)));
+    max_vector = _mm_max_ps(max_vector, _mm_shuffle_ps(max_vector, max_vector, _MM_SHUFFLE(2, 3, 0, 1)));
+    const float tail_max{max_chroma_squared_scalar(rgb_pixels + 3 * i, pixel_count - i)};
+    const float vector_max{_mm_cvtss_f32(max_vector)};
+    return vector_max > tail_max ? vector_max : tail_max;
+}
+
+__attribute__((target("avx2"))) static inline __m256 xyz_transfer_avx2(const __m256 t)
+{
+    const __m256 third{_mm256_set1_ps(1.f / 3.f)};
+    __m256 y{_mm256_castsi256_ps(_mm256_add_epi32(
+        _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(t)), third)), _mm256_set1_epi32(cbrt_magic)))};
+    for (int step = 0; step < 3; ++step) {
+        y = _mm256_mul_ps(_mm256_add_ps(_mm256_add_ps(y, y), _mm256_div_ps(t, _mm256_mul_ps(y, y))), third);
+    }
+    const __m256 linear{_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(xyz_ratio), t), _mm256_set1_ps(xyz_delta))};
+    return _mm256_blendv_ps(linear, y, _mm256_cmp_ps(t, _mm256_set1_ps(xyz_epsilon), _CMP_GT_OQ));
+}
+
+// Squared chroma of 8 pixels (24 bytes starting at `pixels`; reads 28, like classify_8_pixels_avx2).
+__attribute__((target("avx2"))) static inline __m256 chroma_squared_8_pixels_avx2(const uint8_t *pixels)
+{
+    const __m256i raw{_mm256_inserti128_si256(
+        _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 12)), 1)};
+    const __m256i spread_pixels{_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, //
+                                                 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)};
+    const __m256i px{_mm256_shuffle_epi8(raw, spread_pixels)};
+    const __m256i byte_mask{_mm256_set1_epi32(0xff)};
+    const __m256i r{_mm256_and_si256(px, byte_mask)};
+    const __m256i g{_mm256_and_si256(_mm256_srli_epi32(px, 8), byte_mask)};
+    const __m256i b{_mm256_srli_epi32(px, 16)};
+
+    // WHY (R + G) + B order? Matches the scalar sum, so XYZ values are bit-identical.
+    const srgb_to_xyz_tables &xyz{srgb_to_xyz};
+    const __m256 x{_mm256_add_ps(_mm256_add_ps(_mm256_i32gather_ps(xyz.rx, r, 4), _mm256_i32gather_ps(xyz.gx, g, 4)),
+                                 _mm256_i32gather_ps(xyz.bx, b, 4))};
+    const __m256 y{_mm256_add_ps(_mm256_add_ps(_mm256_i32gather_ps(xyz.ry, r, 4), _mm256_i32gather_ps(xyz.gy, g, 4)),
+                                 _mm256_i32gather_ps(xyz.by, b, 4))};
+    const __m256 z{_mm256_add_ps(_mm256_add_ps(_mm256_i32gather_ps(xyz.rz, r, 4), _mm256_i32gather_ps(xyz.gz, g, 4)),
+                                 _mm256_i32gather_ps(xyz.bz, b, 4))};
+
+    const __m256 fx{xyz_transfer_avx2(x)};
+    const __m256 fy{xyz_transfer_avx2(y)};
+    const __m256 fz{xyz_transfer_avx2(z)};
+    const __m256 a_star{_mm256_mul_ps(_mm256_set1_ps(500.0f), _mm256_sub_ps(fx, fy))};
+    const __m256 b_star{_mm256_mul_ps(_mm256_set1_ps(200.0f), _mm256_sub_ps(fy, fz))};
+    return _mm256_add_ps(_mm256_mul_ps(a_star, a_star), _mm256_mul_ps(b_star, b_star));
+}
+
+__attribute__((target("avx2"))) static float max_chroma_squared_avx2(const uint8_t *rgb_pixels, const std::size_t pixel_count)
+{
+    __m256 max_vector{_mm256_setzero_ps()};
+    std::size_t i{0};
+    // WHY stop 10 pixels early? Each 8-pixel load reads 4 bytes past its last pixel.
+    for (; i + 10 <= pixel_count; i += 8) {
+        max_vector = _mm256_max_ps(max_vector, chroma_squared_8_pixels_avx2(rgb_pixels + 3 * i));
+    }
+
+    // Horizontal max of the eight lanes, then the scalar tail.
+    __m128 folded{_mm_max_ps(_mm256_castps256_ps128(max_vector), _mm256_extractf128_ps(max_vector, 1))};
+    folded = _mm_max_ps(folded, _mm_shuffle_ps(folded, folded, _MM_SHUFFLE(1, 0, 3, 2)));
+    folded = _mm_max_ps(folded, _mm_shuffle_ps(folded, folded, _MM_SHUFFLE(2, 3, 0, 1)));
+    const float tail_max{max_chroma_squared_scalar(rgb_pixels + 3 * i, pixel_count - i)};
+    const float vector_max{_mm_cvtss_f32(folded)};
+    return vector_max > tail_max ? vector_max : tail_max;
+}
+
+__attribute__((target("avx512f,avx512bw"))) static inline __m512 xyz_transfer_avx512(const __m512 t)
+{
+    const __m512 third{_mm512_set1_ps(1.f / 3.f)};
+    __m512 y{_mm512_castsi512_ps(_mm512_add_epi32(
+        _mm512_cvttps_epi32(_mm512_mul_ps(_mm512_cvtepi32_ps(_mm512_castps_si512(t)), third)), _mm512_set1_epi32(cbrt_magic)))};
+    for (int step = 0; step < 3; ++step) {
+        y = _mm512_mul_ps(_mm512_add_ps(_mm512_add_ps(y, y), _mm512_div_ps(t, _mm512_mul_ps(y, y))), third);
+    }
+    const __m512 linear{_mm512_add_ps(_mm512_mul_ps(_mm512_set1_ps(xyz_ratio), t), _mm512_set1_ps(xyz_delta))};
+    return _mm512_mask_blend_ps(_mm512_cmp_ps_mask(t, _mm512_set1_ps(xyz_epsilon), _CMP_GT_OQ), linear, y);
+}
+
+// Squared chroma of 16 pixels (48 bytes starting at `pixels`; reads 52, like classify_16_pixels_avx512).
+__attribute__((target("avx512f,avx512bw"))) static inline __m512 chroma_squared_16_pixels_avx512(const uint8_t *pixels)
+{
+    __m512i raw{_mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels)))};
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 12)), 1);
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 24)), 2);
+    raw = _mm512_inserti32x4(raw, _mm_loadu_si128(reinterpret_cast<const __m128i *>(pixels + 36)), 3);
+    const __m512i spread_pixels{_mm512_broadcast_i32x4(_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1))};
+    const __m512i px{_mm512_shuffle_epi8(raw, spread_pixels)};
+    const __m512i byte_mask{_mm512_set1_epi32(0xff)};
+    const __m512i r{_mm512_and_si512(px, byte_mask)};
+    const __m512i g{_mm512_and_si512(_mm512_srli_epi32(px, 8), byte_mask)};
+    const __m512i b{_mm512_srli_epi32(px, 16)};
+
+    const srgb_to_xyz_tables &xyz{srgb_to_xyz};
+    const __m512 x{_mm512_add_ps(_mm512_add_ps(_mm512_i32gather_ps(r, xyz.rx, 4), _mm512_i32gather_ps(g, xyz.gx, 4)),
+                                 _mm512_i32gather_ps(b, xyz.bx, 4))};
+    const __m512 y{_mm512_add_ps(_mm512_add_ps(_mm512_i32gather_ps(r, xyz.ry, 4), _mm512_i32gather_ps(g, xyz.gy, 4)),
+                                 _mm512_i32gather_ps(b, xyz.by, 4))};
+    const __m512 z{_mm512_add_ps(_mm512_add_ps(_mm512_i32gather_ps(r, xyz.rz, 4), _mm512_i32gather_ps(g, xyz.gz, 4)),
+                                 _mm512_i32gather_ps(b, xyz.bz, 4))};
+
+    const __m512 fx{xyz_transfer_avx512(x)};
+    const __m512 fy{xyz_transfer_avx512(y)};
+    const __m512 fz{xyz_transfer_avx512(z)};
+    const __m512 a_star{_mm512_mul_ps(_mm512_set1_ps(500.0f), _mm512_sub_ps(fx, fy))};
+    const __m512 b_star{_mm512_mul_ps(_mm512_set1_ps(200.0f), _mm512_sub_ps(fy, fz))};
+    return _mm512_add_ps(_mm512_mul_ps(a_star, a_star), _mm512_mul_ps(b_star, b_star));
+}
+
+__attribute__((target("avx512f,avx512bw"))) static float max_chroma_squared_avx512(const uint8_t *rgb_pixels,
+                                                                                   const std::size_t pixel_count)
+{
+    __m512 max_vector{_mm512_setzero_ps()};
+    std::size_t i{0};
+    // WHY stop 18 pixels early? Each 16-pixel load reads 4 bytes past its last pixel.
+    for (; i + 18 <= pixel_count; i += 16) {
+        max_vector = _mm512_max_ps(max_vector, chroma_squared_16_pixels_avx512(rgb_pixels + 3 * i));
+    }
+
+    const float tail_max{max_chroma_squared_scalar(rgb_pixels + 3 * i, pixel_count - i)};
+    const float vector_max{_mm512_reduce_max_ps(max_vector)};
+    return vector_max > tail_max ? vector_max : tail_max;
+}
+
+// --- Runtime Dispatch ---
+namespace {
+
+// A block LUT kernel for one resolution.
+template <std::size_t Blocks> using lut_kernel = std::size_t (*)(const uint8_t *, std::size_t, const chroma_lut<Blocks> &);
+
+// The kernels used for one instruction set level.
+struct kernel_set {
+    kernel_isa isa;
+    const char *name;
+    // WHY a tuple? One kernel per chroma_lut_ref resolution, picked by type in count_colored_pixels().
+    std::tuple<lut_kernel<64>, lut_kernel<128>, lut_kernel<256>> count_colored;
+    std::size_t (*count_colored_exact)(const uint8_t *, std::size_t, const chroma_bitset_t &);
+    std::size_t (*count_colored_yuv)(const uint8_t *, const uint8_t *, const uint8_t *, std::size_t, std::size_t, int,
+                                     const chroma_bitset_t &);
+    float (*max_chroma_squared)(const uint8_t *, std::size_t);
+};
+
+// WHY indexed by kernel_isa? select_kernel_isa() and the name lookups use the enum value directly.
+// WHY scalar YUV counting at the SSE4.2 level? Without gathers the vector version would only add
+// shuffles around the same four table loads.
+constexpr kernel_set kernel_sets[] = {
+    {kernel_isa::SCALAR,
+     "scalar",
+     {count_colored_pixels_scalar<64>, count_colored_pixels_scalar<128>, count_colored_pixels_scalar<256>},
+     count_colored_pixels_exact_scalar,
+     count_colored_pixels_yuv_scalar,
+     max_chroma_squared_scalar},
+    {kernel_isa::SSE42,
+     "sse4.2",
+     {count_colored_pixels_sse42<64>, count_colored_pixels_sse42<128>, count_colored_pixels_sse42<256>},
+     count_colored_pixels_exact_sse42,
+     count_colored_pixels_yuv_scalar,
+     max_chroma_squared_sse42},
+    {kernel_isa::AVX2,
+     "avx2",
+     {count_colored_pixels_avx2<64>, count_colored_pixels_avx2<128>, count_colored_pixels_avx2<256>},
+     count_colored_pixels_exact_avx2,
+     count_colored_pixels_yuv_avx2,
+     max_chroma_squared_avx2},
+    {kernel_isa::AVX512,
+     "avx512",
+     {count_colored_pixels_avx512<64>, count_colored_pixels_avx512<128>, count_colored_pixels_avx512<256>},
+     count_colored_pixels_exact_avx512,
+     count_colored_pixels_yuv_avx512,
+     max_chroma_squared_avx512},
+};
+
+const kernel_set &kernels_for(const kernel_isa isa) { return kernel_sets[static_cast<int>(isa)]; }
+
+// WHY atomic pointer? Workers read it on every image; it is written once before they start,
+// and lazily resolved to the best level if nobody selected one.
+std::atomic<const kernel_set *> active_kernels{nullptr};
+
+const kernel_set &current_kernels()
+{
+    const kernel_set *kernels{active_kernels.load(std::memory_order_acquire)};
+    if (!kernels) {
+        kernels = &kernels_for(best_kernel_isa());
+        active_kernels.store(kernels, std::memory_order_release);
+    }
+    return *kernels;
+}
+
+} // namespace
+
+const char *kernel_isa_name(const kernel_isa isa) { return kernels_for(isa).name; }
+
+std::optional<kernel_isa> parse_kernel_isa(const std::string_view name)
+{
+    for (const auto &kernels : kernel_sets) {
+        if (name == kernels.name)
+            return kernels.isa;
+    }
+    return std::nullopt;
+}
+
+bool cpu_supports_kernel_isa(const kernel_isa isa)
+{
+    // WHY __builtin_cpu_init? Makes __builtin_cpu_supports safe even if called from a static initializer.
+    __builtin_cpu_init();
+    switch (isa) {
+    case kernel_isa::SCALAR:
+        return true;
+    case kernel_isa::SSE42:
+        return __builtin_cpu_supports("sse4.2");
+    case kernel_isa::AVX2:
+        return __builtin_cpu_supports("avx2");
+    case kernel_isa::AVX512:
+        // WHY also popcnt? The AVX-512 kernel counts mask bits with popcnt.
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("popcnt");
+    }
+    return false;
+}
+
+kernel_isa best_kernel_isa()
+{
+    for (const kernel_isa isa : {kernel_isa::AVX512, kernel_isa::AVX2, kernel_isa::SSE42}) {
+        if (cpu_supports_kernel_isa(isa))
+            return isa;
+    }
+    return kernel_isa::SCALAR;
+}
+
+void select_kernel_isa(const kernel_isa isa) { active_kernels.store(&kernels_for(isa), std::memory_order_release); }
+
+kernel_isa selected_kernel_isa() { return current_kernels().isa; }
+
+template <std::size_t Blocks>
+std::size_t count_colored_pixels(const uint8_t *rgb_pixels, const std::size_t pixel_count,
+                                 const chroma_lut<Blocks> &chroma_check_lut)
+{
+    return std::get<lut_kernel<Blocks>>(current_kernels().count_colored)(rgb_pixels, pixel_count, chroma_check_lut);
+}
+
+template std::size_t count_colored_pixels<64>(const uint8_t *, std::size_t, const chroma_lut<64> &);
+template std::size_t count_colored_pixels<128>(const uint8_t *, std::size_t, const chroma_lut<128> &);
+template std::size_t count_colored_pixels<256>(const uint8_t *, std::size_t, const chroma_lut<256> &);
+
+std::size_t count_colored_pixels(const uint8_t *rgb_pixels, const std::size_t pixel_count, const chroma_lut_ref chroma_check_lut)
+{
+    // WHY visit per call? Callers pass thousands of pixels at once; the kernel itself is fixed to one resolution.
+    return std::visit([&](const auto *lut) { return count_colored_pixels(rgb_pixels, pixel_count, *lut); }, chroma_check_lut);
+}
+
+std::size_t count_colored_pixels_exact(const uint8_t *rgb_pixels, const std::size_t pixel_count, const chroma_bitset_t &chroma_bits)
+{
+    return current_kernels().count_colored_exact(rgb_pixels, pixel_count, chroma_bits);
+}
+
+std::size_t count_colored_pixels_yuv(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row, const std::size_t first_x,
+                                     const std::size_t pixel_count, const int chroma_shift_x, const chroma_bitset_t &yuv_bits)
+{
+    return current_kernels().count_colored_yuv(y_row, u_row, v_row, first_x, pixel_count, chroma_shift_x, yuv_bits);
+}
+
+float max_chroma_squared(const uint8_t *rgb_pixels, const std::size_t pixel_count)
+{
+    return current_kernels().max_chroma_squared(rgb_pixels, pixel_count);
+}
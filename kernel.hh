@@ -0,0 +1,104 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "lut.hh" // Includes definition of chroma_lut_t
+
+// Pixel classification kernels.
+// Every kernel counts the pixels of a packed RGB buffer (3 bytes per pixel) whose B value falls
+// outside the gray [min, max] B range stored in the LUT for their (R,G) block ((R>>2, G>>2) in
+// the default 64x64 LUT).
+// All variants return exactly the same count for the same input.
+//
+// The SIMD variants are compiled with per-function target attributes, so one binary built with
+// the default flags carries all of them; the best one the running CPU supports is chosen at
+// startup (or forced with select_kernel_isa()).
+
+// Instruction set levels the kernels are built for, slowest first.
+enum class kernel_isa { SCALAR, SSE42, AVX2, AVX512 };
+
+// Block LUT kernels, one per resolution of chroma_lut (instantiated for 64, 128 and 256 blocks).
+// WHY a template parameter? The block shift and index width are then constants in the inner loops.
+// WHY the target attributes here? GCC gives every instance of a function template the target of
+// its first declaration.
+// Each kernel also takes a get_lazy_chroma_lut() table, and fills the blocks its pixels reach.
+
+// Portable one-pixel-at-a-time reference kernel.
+template <std::size_t Blocks>
+std::size_t count_colored_pixels_scalar(const uint8_t *rgb_pixels, std::size_t pixel_count,
+                                        const chroma_lut<Blocks> &chroma_check_lut);
+
+// SSE4.2 kernel: 16 pixels per iteration, LUT entries fetched with scalar loads (no gather).
+template <std::size_t Blocks>
+__attribute__((target("sse4.2"))) std::size_t count_colored_pixels_sse42(const uint8_t *rgb_pixels, std::size_t pixel_count,
+                                                                         const chroma_lut<Blocks> &chroma_check_lut);
+
+// AVX2 kernel: 32 pixels per iteration, LUT entries fetched with gathers.
+template <std::size_t Blocks>
+__attribute__((target("avx2"))) std::size_t count_colored_pixels_avx2(const uint8_t *rgb_pixels, std::size_t pixel_count,
+                                                                      const chroma_lut<Blocks> &chroma_check_lut);
+
+// AVX-512 (F + BW) kernel: 64 pixels per iteration, results kept in mask registers.
+template <std::size_t Blocks>
+__attribute__((target("avx512f,avx512bw,popcnt"))) std::size_t
+count_colored_pixels_avx512(const uint8_t *rgb_pixels, std::size_t pixel_count, const chroma_lut<Blocks> &chroma_check_lut);
+
+// Counts colored pixels with the selected kernel.
+template <std::size_t Blocks>
+std::size_t count_colored_pixels(const uint8_t *rgb_pixels, std::size_t pixel_count, const chroma_lut<Blocks> &chroma_check_lut);
+
+// Same for a table whose resolution was picked at run time.
+std::size_t count_colored_pixels(const uint8_t *rgb_pixels, std::size_t pixel_count, chroma_lut_ref chroma_check_lut);
+
+// Exact-table kernels: count the pixels whose bit is set in a chroma_bitset_t (one load and one
+// bit test per pixel). Same ISA levels and tail handling as the LUT kernels above.
+std::size_t count_colored_pixels_exact_scalar(const uint8_t *rgb_pixels, std::size_t pixel_count,
+                                              const chroma_bitset_t &chroma_bits);
+std::size_t count_colored_pixels_exact_sse42(const uint8_t *rgb_pixels, std::size_t pixel_count,
+                                             const chroma_bitset_t &chroma_bits);
+std::size_t count_colored_pixels_exact_avx2(const uint8_t *rgb_pixels, std::size_t pixel_count,
+                                            const chroma_bitset_t &chroma_bits);
+std::size_t count_colored_pixels_exact_avx512(const uint8_t *rgb_pixels, std::size_t pixel_count,
+                                              const chroma_bitset_t &chroma_bits);
+
+// Counts colored pixels against the exact table with the selected kernel.
+std::size_t count_colored_pixels_exact(const uint8_t *rgb_pixels, std::size_t pixel_count, const chroma_bitset_t &chroma_bits);
+
+// YUV kernels: count the pixels x = first_x .. first_x + pixel_count - 1 of one row of an 8-bit
+// planar YUV image whose Y | U << 8 | V << 16 bit is set in a table from get_yuv_chroma_bitset().
+// Pixel x uses chroma sample x >> chroma_shift_x (0 for 4:4:4, 1 for 4:2:2 and 4:2:0), so the rows
+// are never converted to RGB. No kernel reads past the samples of the given pixels.
+std::size_t count_colored_pixels_yuv_scalar(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row, std::size_t first_x,
+                                            std::size_t pixel_count, int chroma_shift_x, const chroma_bitset_t &yuv_bits);
+std::size_t count_colored_pixels_yuv_avx2(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row, std::size_t first_x,
+                                          std::size_t pixel_count, int chroma_shift_x, const chroma_bitset_t &yuv_bits);
+std::size_t count_colored_pixels_yuv_avx512(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row, std::size_t first_x,
+                                            std::size_t pixel_count, int chroma_shift_x, const chroma_bitset_t &yuv_bits);
+
+// Counts colored pixels of a YUV row segment with the selected kernel.
+std::size_t count_colored_pixels_yuv(const uint8_t *y_row, const uint8_t *u_row, const uint8_t *v_row, std::size_t first_x,
+                                     std::size_t pixel_count, int chroma_shift_x, const chroma_bitset_t &yuv_bits);
+
+// Returns the largest compute_chroma_squared() value over the pixels, using the selected kernel.
+float max_chroma_squared(const uint8_t *rgb_pixels, std::size_t pixel_count);
+
+// Name used by --kernel and --version (e.g. "avx2").
+const char *kernel_isa_name(kernel_isa isa);
+
+// Parses a --kernel name; returns std::nullopt for unknown names.
+std::optional<kernel_isa> parse_kernel_isa(std::string_view name);
+
+// Reports whether the running CPU can execute the kernels built for `isa`.
+bool cpu_supports_kernel_isa(kernel_isa isa);
+
+// The fastest kernel level the running CPU supports.
+kernel_isa best_kernel_isa();
+
+// Routes the dispatching functions above (count_colored_pixels() etc.) to the kernels for `isa`.
+// The caller must check cpu_supports_kernel_isa() first. Call before starting workers.
+void select_kernel_isa(kernel_isa isa);
+
+// The kernel level currently in use (best_kernel_isa() unless overridden).
+kernel_isa selected_kernel_isa();
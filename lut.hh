@@ -1,25 +1,156 @@
 #pragma once
 #include <array>
+#include <atomic>  // WHY: For the atomic_ref of load_chroma_lut_entry.
+#include <bit>     // WHY: For countr_zero in rg_block_shift.
+#include <compare> // WHY: For the defaulted comparison of yuv_conversion (cache key).
+#include <cstddef>
 #include <cstdint>
 #include <iostream> // WHY: For std::ostream default in dump_lookup_table.
+#include <memory>   // WHY: For the shared handles of share_chroma_lut.
+#include <variant>  // WHY: For chroma_lut_ref.
 
-// Constants defining the structure of the R-G lookup table.
+// Constants defining the structure of the default R-G lookup table.
 constexpr int RG_LUT_BLOCKS = 64; // WHY 64? LUT dimension (64x64), R & G are divided by 4 (256/4 = 64).
 constexpr int RG_BLOCK_SIZE = 4;  // WHY 4? Size of R/G block aggregated per LUT entry (4x4 = 16 R,G pairs).
 // constexpr int FSIZE = 512; // This constant seems unused, removed.
 constexpr int RGB_LUT_SIZE = 256; // WHY 256? Size needed for direct lookup using 8-bit R,G,B values.
 
-// Type alias for the 2D LUT array. Stores packed min/max B values.
-using chroma_lut_t = std::array<std::array<uint16_t, RG_LUT_BLOCKS>, RG_LUT_BLOCKS>;
+// Block LUT with Blocks x Blocks entries, one per block of (256 / Blocks)^2 (R,G) pairs, each
+// holding the packed min/max gray B of its block. Built for Blocks = 64 (8 KiB), 128 (32 KiB)
+// and 256 (128 KiB, one entry per (R,G) pair), selected with --lut-blocks.
+// WHY offer finer tables? A block's B range is the union over all its pairs, so coarse blocks let
+// some colored pixels through as gray; finer tables misclassify fewer but take more cache.
+template <std::size_t Blocks> using chroma_lut = std::array<std::array<uint16_t, Blocks>, Blocks>;
+
+// R or G >> rg_block_shift<Blocks> is the block index of that channel.
+template <std::size_t Blocks> constexpr int rg_block_shift = std::countr_zero(256u / Blocks);
+
+// Type alias for the default 2D LUT array. Stores packed min/max B values.
+using chroma_lut_t = chroma_lut<RG_LUT_BLOCKS>;
+
+// A block LUT of any built resolution, for code that picks one at run time.
+using chroma_lut_ref = std::variant<const chroma_lut<64> *, const chroma_lut<128> *, const chroma_lut<256> *>;
+
+// Blocks per side of the table a chroma_lut_ref points to.
+inline int lut_blocks(const chroma_lut_ref lut) { return 64 << lut.index(); }
+
+// Generated tables kept for share_chroma_lut() callers, per resolution. WHY 64? At 8 KiB a table,
+// 512 KiB covers a sweep in 0.5 steps up to 32; thresholds beyond that are regenerated when asked
+// for again.
+constexpr std::size_t CHROMA_LUT_CACHE_SIZE = 64;
 
 // Retrieves or generates the lookup table for a given chroma threshold.
-const chroma_lut_t &get_chroma_lut(float chroma_threshold);
+// Thread-safe: each table is generated once, even when several threads ask for it at the same time.
+// The table is kept for the rest of the run, so the reference stays valid; meant for the few
+// thresholds of one cpix run. Only 64x64 tables are built at compile time (see lut_presets.cc);
+// finer ones are always generated.
+template <std::size_t Blocks = RG_LUT_BLOCKS> const chroma_lut<Blocks> &get_chroma_lut(float chroma_threshold);
+
+// get_chroma_lut() for a resolution chosen at run time: `lut_blocks` is 64, 128 or 256.
+chroma_lut_ref get_chroma_lut(int lut_blocks, float chroma_threshold);
+
+// Like get_chroma_lut(), for long-lived callers that go through many thresholds (a library or
+// daemon): at most CHROMA_LUT_CACHE_SIZE of these tables are cached, least recently used ones
+// are dropped first, and a dropped table lives on until its last handle goes away.
+template <std::size_t Blocks = RG_LUT_BLOCKS> std::shared_ptr<const chroma_lut<Blocks>> share_chroma_lut(float chroma_threshold);
+
+// Makes get_chroma_lut() and share_chroma_lut() return `lut` for `chroma_threshold` at its
+// resolution instead of a built-in or generated table; used for a table mapped from --lut-file.
+// `lut` must stay valid for the rest of the run. Call before the table is first asked for.
+void provide_chroma_lut(float chroma_threshold, chroma_lut_ref lut);
+
+// Entry of a get_lazy_chroma_lut() table whose block has not been computed yet. WHY min 1 > max 0?
+// Generated entries never hold it: a block without gray B is stored as min 255, max 0.
+constexpr uint16_t CHROMA_LUT_UNKNOWN = 0x0100;
+
+// Like get_chroma_lut(), but a table that is neither provided nor a preset is not generated up
+// front: every entry starts as CHROMA_LUT_UNKNOWN, and the kernels have fill_chroma_lut_entry()
+// compute a block the first time a pixel falls in it. Thread-safe; kept for the whole run.
+// WHY? Generating a whole table costs milliseconds per threshold, more than a few small images
+// take to classify, while a manga page only reaches blocks near the gray axis. Startup then
+// scales with the colors present. Callers that read entries themselves must handle
+// CHROMA_LUT_UNKNOWN (see the kernels), or use get_chroma_lut().
+template <std::size_t Blocks = RG_LUT_BLOCKS> const chroma_lut<Blocks> &get_lazy_chroma_lut(float chroma_threshold);
+
+// get_lazy_chroma_lut() for a resolution chosen at run time: `lut_blocks` is 64, 128 or 256.
+chroma_lut_ref get_lazy_chroma_lut(int lut_blocks, float chroma_threshold);
+
+// Whether `lut` is a get_lazy_chroma_lut() table, whose entries may still be CHROMA_LUT_UNKNOWN.
+// Lock-free. WHY ask? The kernels do once per call, so complete tables skip the test per entry.
+template <std::size_t Blocks> bool is_lazy_chroma_lut(const chroma_lut<Blocks> &lut);
+
+// Computes entry [R_block][G_block] of a get_lazy_chroma_lut() table, stores it atomically and
+// returns it. Entries of any other table are returned as they are. Safe to call from any thread;
+// the first load of a block that returns CHROMA_LUT_UNKNOWN calls it, every later load gets the entry.
+template <std::size_t Blocks> uint16_t fill_chroma_lut_entry(const chroma_lut<Blocks> &lut, int R_block, int G_block);
+
+// Reads an entry while fill_chroma_lut_entry() may be storing it from another thread.
+// WHY const_cast? std::atomic_ref<const T> only arrives in C++26; a load writes nothing, and on
+// x86 it is the same plain 16-bit load as an ordinary read.
+template <std::size_t Blocks>
+inline uint16_t load_chroma_lut_entry(const chroma_lut<Blocks> &lut, const int R_block, const int G_block)
+{
+    return std::atomic_ref{const_cast<uint16_t &>(lut[R_block][G_block])}.load(std::memory_order_relaxed);
+}
+
+// load_chroma_lut_entry() by index R_block * Blocks + G_block, the form the SIMD kernels compute.
+template <std::size_t Blocks> inline uint16_t load_chroma_lut_entry(const chroma_lut<Blocks> &lut, const std::size_t lut_index)
+{
+    return std::atomic_ref{const_cast<uint16_t &>(lut.data()->data()[lut_index])}.load(std::memory_order_relaxed);
+}
+
+// Exact classification table: one bit per 24-bit RGB value, set when chroma >= threshold.
+// WHY bit index R | G << 8 | B << 16? That is the little-endian value of the pixel bytes, so the
+// SIMD kernels can use a pixel widened to 32 bits directly as the bit index.
+constexpr std::size_t RGB_BITSET_WORDS = (std::size_t{1} << 24) / 64; // 2 MiB of uint64_t words.
+using chroma_bitset_t = std::array<uint64_t, RGB_BITSET_WORDS>;
+
+// Retrieves or generates the exact bitset for a given chroma threshold.
+// Unlike the block LUTs, every RGB value is classified by its own chroma, at the cost of a
+// 2 MiB table (versus 8 KiB). Thread-safe; the returned reference stays valid for the whole run.
+const chroma_bitset_t &get_chroma_bitset(float chroma_threshold);
+
+// Which library's YUV -> RGB arithmetic a yuv_conversion reproduces.
+// WHY per library? The table must match the RGB the decoder would have produced: libavif uses a
+// float formula for any matrix, libwebp a fixed-point BT.601 limited-range one.
+enum class yuv_formula { LIBAVIF, LIBWEBP };
+
+// How an 8-bit YUV image converts to RGB: the luma weights of its matrix (ITU-T H.273 matrix
+// coefficients, resolved by the decoder) and whether it uses the full 0-255 range.
+// LIBWEBP ignores kr, kb and full_range (always BT.601, limited range).
+struct yuv_conversion {
+    float kr{0.299f}; // WHY these defaults? BT.601, which libavif also assumes for unspecified matrices.
+    float kb{0.114f};
+    bool full_range{false};
+    yuv_formula formula{yuv_formula::LIBAVIF};
+
+    auto operator<=>(const yuv_conversion &) const = default;
+};
+
+// YUV classification table: bit Y | U << 8 | V << 16 is set when that 8-bit YUV value converts
+// (with the decoder's own formula, see yuv_formula) to an RGB value that the block LUT with
+// `lut_blocks` blocks per side, or the exact bitset when `exact` is set, counts as colored. Same
+// layout as chroma_bitset_t, so a YUV triple stored as 3 bytes can go through the exact kernels.
+// Thread-safe and cached per (threshold, exact, lut_blocks, conversion); generates
+// get_chroma_lut(lut_blocks, chroma_threshold) when no one has. WHY not the lazy table? The
+// conversions reach most of the (R,G) plane, so filling it block by block would only cost more.
+const chroma_bitset_t &get_yuv_chroma_bitset(float chroma_threshold, bool exact, int lut_blocks, const yuv_conversion &conversion);
 
 // Calculates squared chroma using precomputed tables (optimized).
 float compute_chroma_squared(uint8_t r_srgb, uint8_t g_srgb, uint8_t b_srgb);
 
+// The 256-entry tables behind compute_chroma_squared(): the contribution of one sRGB channel
+// value to the white-point-normalized X, Y and Z. X = rx[r] + gx[g] + bx[b], and so on.
+struct srgb_to_xyz_tables {
+    const float *rx, *ry, *rz;
+    const float *gx, *gy, *gz;
+    const float *bx, *by, *bz;
+};
+extern const srgb_to_xyz_tables srgb_to_xyz;
+
 // Calculates actual chroma (slower, used for LUT generation).
 double compute_chroma(uint8_t r_srgb, uint8_t g_srgb, uint8_t b_srgb);
 
-// Dumps the lookup table for a given threshold to an output stream (defaults to std::cout).
-void dump_lookup_table(int threshold, std::ostream &output_stream = std::cout);
+// Dumps the lookup table with `lut_blocks` blocks per side for a given threshold to an output
+// stream (defaults to std::cout).
+void dump_lookup_table(int threshold, int lut_blocks = RG_LUT_BLOCKS, std::ostream &output_stream = std::cout);
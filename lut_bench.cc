@@ -0,0 +1,148 @@
+// cpix-lut-bench: compares the block LUT resolutions --lut-blocks offers on real images.
+// For each threshold and resolution it reports the table size, the time to get the table, the
+// single-thread throughput of the selected kernel, and the colored pixels the table lets through
+// as gray compared with the exact classifier (-x).
+//
+// Usage: cpix-lut-bench [-t THRESHOLD]... [--kernel NAME] IMAGE...
+// WHY plain argv parsing? A developer tool with three options does not need CLI11's help output.
+#include <chrono>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "decode.hh"
+#include "kernel.hh"
+#include "lut.hh"
+
+namespace {
+
+// Minimum time spent classifying the images per table, so short inputs still give stable numbers.
+constexpr double min_benchmark_seconds{0.5};
+
+double seconds_since(const std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// RGB values the table counts as gray although their chroma reaches the threshold.
+// WHY only this direction? A block's B range holds every gray B of each of its pairs, so the
+// table never counts a gray value as colored.
+template <std::size_t Blocks> std::size_t false_gray_values(const chroma_lut<Blocks> &lut, const chroma_bitset_t &exact_bits)
+{
+    std::size_t count{0};
+    for (uint32_t rgb = 0; rgb < (uint32_t{1} << 24); ++rgb) {
+        const uint32_t r{rgb & 0xff};
+        const uint32_t g{rgb >> 8 & 0xff};
+        const uint32_t b{rgb >> 16};
+        const uint16_t min_max_b_packed{lut[r >> rg_block_shift<Blocks>][g >> rg_block_shift<Blocks>]};
+        const bool lut_gray{b >= (min_max_b_packed >> 8u) && b <= (min_max_b_packed & 0xffu)};
+        const bool exact_colored{((exact_bits[rgb >> 6] >> (rgb & 63)) & 1) != 0};
+        count += lut_gray && exact_colored;
+    }
+    return count;
+}
+
+// Seconds the first get_chroma_lut() for this table takes: what a run with this -t pays at startup
+// (nothing for a preset). WHY before get_chroma_bitset()? That fetches the 64x64 table itself.
+template <std::size_t Blocks> double build_seconds(const float chroma_threshold)
+{
+    const auto build_start{std::chrono::steady_clock::now()};
+    get_chroma_lut<Blocks>(chroma_threshold);
+    return seconds_since(build_start);
+}
+
+template <std::size_t Blocks>
+void benchmark_table(const float chroma_threshold, const double build_seconds, const std::vector<uint8_t> &rgb_pixels,
+                     const chroma_bitset_t &exact_bits, const std::size_t exact_colored)
+{
+    const std::size_t pixel_count{rgb_pixels.size() / 3};
+    const chroma_lut<Blocks> &lut{get_chroma_lut<Blocks>(chroma_threshold)};
+
+    std::size_t lut_colored{0};
+    std::size_t passes{0};
+    const auto classify_start{std::chrono::steady_clock::now()};
+    do {
+        lut_colored = count_colored_pixels(rgb_pixels.data(), pixel_count, lut);
+        ++passes;
+    } while (seconds_since(classify_start) < min_benchmark_seconds);
+    const double classify_seconds{seconds_since(classify_start)};
+
+    const std::size_t missed{exact_colored - lut_colored};
+    std::cout << std::format("{:>9} {:>6} {:>9} {:>9.2f} {:>9.0f} {:>9.3f} {:>9.3f} {:>9.2f} {:>12}\n", chroma_threshold, Blocks,
+                             sizeof(lut) / 1024, build_seconds * 1e3,
+                             static_cast<double>(pixel_count) * passes / classify_seconds / 1e6,
+                             100.0 * lut_colored / pixel_count, 100.0 * missed / pixel_count,
+                             exact_colored ? 100.0 * missed / exact_colored : 0.0, false_gray_values(lut, exact_bits));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::vector<float> thresholds;
+    std::vector<std::string> image_filenames;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view argument{argv[i]};
+        if ((argument == "-t" || argument == "--kernel") && i + 1 == argc) {
+            std::cerr << "ERROR: " << argument << " needs a value\n";
+            return 1;
+        }
+        if (argument == "-t") {
+            try {
+                thresholds.push_back(std::stof(argv[++i]));
+            } catch (const std::exception &) {
+                std::cerr << "ERROR: Invalid threshold: " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (argument == "--kernel") {
+            const std::optional<kernel_isa> isa{parse_kernel_isa(argv[++i])};
+            if (!isa || !cpu_supports_kernel_isa(*isa)) {
+                std::cerr << "ERROR: Unknown or unsupported kernel: " << argv[i] << "\n";
+                return 1;
+            }
+            select_kernel_isa(*isa);
+        } else {
+            image_filenames.emplace_back(argument);
+        }
+    }
+    if (image_filenames.empty()) {
+        std::cerr << "Usage: " << argv[0] << " [-t THRESHOLD]... [--kernel NAME] IMAGE...\n";
+        return 1;
+    }
+    if (thresholds.empty())
+        thresholds = {5.f, 13.f}; // The default and --sepia.
+
+    // WHY one buffer? The throughput then covers every image at once, like a batch run.
+    std::vector<uint8_t> rgb_pixels;
+    for (const std::string &filename : image_filenames) {
+        int width{0};
+        int height{0};
+        const smart_pixels_ptr pixels{decode_image(filename, width, height)};
+        if (!pixels)
+            return 1; // decode_image() printed the error.
+        rgb_pixels.insert(rgb_pixels.end(), pixels.get(), pixels.get() + static_cast<std::size_t>(width) * height * 3);
+    }
+    const std::size_t pixel_count{rgb_pixels.size() / 3};
+
+    std::cout << std::format("{} images, {:.1f} Mpx, kernel {}\n", image_filenames.size(), pixel_count / 1e6,
+                             kernel_isa_name(selected_kernel_isa()));
+    // missed %: pixels counted as gray that -x counts as colored, of all pixels and of the colored ones.
+    // false-gray: RGB values (of 16.7M) the table counts as gray although -x counts them as colored.
+    std::cout << std::format("{:>9} {:>6} {:>9} {:>9} {:>9} {:>9} {:>9} {:>9} {:>12}\n", "threshold", "blocks", "KiB",
+                             "build ms", "Mpx/s", "colored%", "missed%", "of color%", "false-gray");
+    for (const float chroma_threshold : thresholds) {
+        const double build_seconds_64{build_seconds<64>(chroma_threshold)};
+        const double build_seconds_128{build_seconds<128>(chroma_threshold)};
+        const double build_seconds_256{build_seconds<256>(chroma_threshold)};
+        const chroma_bitset_t &exact_bits{get_chroma_bitset(chroma_threshold)};
+        const std::size_t exact_colored{count_colored_pixels_exact(rgb_pixels.data(), pixel_count, exact_bits)};
+        benchmark_table<64>(chroma_threshold, build_seconds_64, rgb_pixels, exact_bits, exact_colored);
+        benchmark_table<128>(chroma_threshold, build_seconds_128, rgb_pixels, exact_bits, exact_colored);
+        benchmark_table<256>(chroma_threshold, build_seconds_256, rgb_pixels, exact_bits, exact_colored);
+    }
+    return 0;
+}
@@ -0,0 +1,173 @@
+#include "lut_file.hh"
+
+#include <cerrno>
+#include <cmath>   // For isfinite
+#include <cstdint>
+#include <cstdio>  // For rename
+#include <cstring> // For memcmp, memcpy, strerror
+#include <iostream>
+#include <span>
+#include <variant>
+#include <vector>
+
+#include <fcntl.h>    // For open
+#include <sys/mman.h> // For mmap, munmap
+#include <sys/stat.h> // For fstat
+#include <unistd.h>   // For write, close, getpid, unlink
+
+#include "record_store.hh" // For hash_bytes
+
+namespace {
+
+// Start of every LUT file. WHY the table geometry? The reader picks the table type from it, and
+// a build without that resolution refuses the file instead of misreading it.
+struct lut_file_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t payload_offset; // Where the table starts; a multiple of lut_file_page_size.
+    uint32_t payload_bytes;  // sizeof(chroma_lut<lut_blocks>)
+    uint32_t lut_blocks;     // Blocks per side: 64, 128 or 256.
+    uint32_t block_size;     // 256 / lut_blocks
+    float chroma_threshold;
+    uint64_t checksum; // hash_bytes() of the table.
+};
+
+constexpr char lut_file_magic[8]{'C', 'P', 'I', 'X', 'C', 'L', 'U', 'T'};
+constexpr uint32_t lut_file_version{1};
+// WHY page-aligned? The table then starts on a page of its own in every process that maps it.
+constexpr uint32_t lut_file_page_size{4096};
+
+// The bytes of the table `lut` points to.
+std::span<const uint8_t> table_bytes(const chroma_lut_ref lut)
+{
+    return std::visit([](const auto *table) { return std::span{reinterpret_cast<const uint8_t *>(table), sizeof(*table)}; }, lut);
+}
+
+uint64_t table_checksum(const std::span<const uint8_t> table) { return hash_bytes(table); }
+
+// Whether a file's table geometry is one of the chroma_lut_ref resolutions.
+bool supported_geometry(const lut_file_header &header)
+{
+    return (header.lut_blocks == 64 || header.lut_blocks == 128 || header.lut_blocks == 256) &&
+           header.block_size * header.lut_blocks == 256 &&
+           header.payload_bytes == header.lut_blocks * header.lut_blocks * sizeof(uint16_t);
+}
+
+// The table at `table` with the geometry supported_geometry() accepted.
+chroma_lut_ref table_at(const void *table, const uint32_t lut_blocks)
+{
+    switch (lut_blocks) {
+    case 64:
+        return static_cast<const chroma_lut<64> *>(table);
+    case 128:
+        return static_cast<const chroma_lut<128> *>(table);
+    default:
+        return static_cast<const chroma_lut<256> *>(table);
+    }
+}
+
+} // namespace
+
+bool write_chroma_lut_file(const std::string &path, const float chroma_threshold, const chroma_lut_ref lut)
+{
+    const std::span<const uint8_t> table{table_bytes(lut)};
+    lut_file_header header{};
+    std::memcpy(header.magic, lut_file_magic, sizeof(header.magic));
+    header.version = lut_file_version;
+    header.payload_offset = lut_file_page_size;
+    header.payload_bytes = static_cast<uint32_t>(table.size());
+    header.lut_blocks = static_cast<uint32_t>(lut_blocks(lut));
+    header.block_size = 256 / header.lut_blocks;
+    header.chroma_threshold = chroma_threshold;
+    header.checksum = table_checksum(table);
+
+    std::vector<uint8_t> contents(header.payload_offset + table.size());
+    std::memcpy(contents.data(), &header, sizeof(header));
+    std::memcpy(contents.data() + header.payload_offset, table.data(), table.size());
+
+    const std::string temporary_path{path + ".tmp" + std::to_string(getpid())};
+    const int fd{::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)};
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot create " << temporary_path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    // WHY one write()? The file is at most 132 KiB; a regular file only writes less on an error.
+    const ssize_t written{write(fd, contents.data(), contents.size())};
+    const int write_errno{errno};
+    if (close(fd) != 0 || written != static_cast<ssize_t>(contents.size())) {
+        std::cerr << "ERROR: Cannot write " << temporary_path << ": " << (written < 0 ? std::strerror(write_errno) : "short write")
+                  << "\n";
+        unlink(temporary_path.c_str());
+        return false;
+    }
+    if (rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::cerr << "ERROR: Cannot replace " << path << ": " << std::strerror(errno) << "\n";
+        unlink(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+chroma_lut_file::~chroma_lut_file()
+{
+    if (mapping)
+        munmap(mapping, mapping_size);
+}
+
+bool chroma_lut_file::open(const std::string &path)
+{
+    const int fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0) {
+        std::cerr << "ERROR: Cannot stat " << path << ": " << std::strerror(errno) << "\n";
+        close(fd);
+        return false;
+    }
+    const std::size_t file_size{static_cast<std::size_t>(file_status.st_size)};
+    if (file_size < sizeof(lut_file_header)) {
+        std::cerr << "ERROR: " << path << " has an unknown format or version\n";
+        close(fd);
+        return false;
+    }
+    // WHY MAP_SHARED? Every process mapping the file reads the same page-cache pages.
+    void *const mapped{mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0)};
+    close(fd); // WHY close now? The mapping keeps the file open.
+    if (mapped == MAP_FAILED) {
+        std::cerr << "ERROR: Cannot map " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    mapping = mapped;
+    mapping_size = file_size;
+
+    lut_file_header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, lut_file_magic, sizeof(header.magic)) != 0 || header.version != lut_file_version) {
+        std::cerr << "ERROR: " << path << " has an unknown format or version\n";
+        return false;
+    }
+    if (!supported_geometry(header)) {
+        std::cerr << "ERROR: " << path << " holds a " << header.lut_blocks << "x" << header.lut_blocks
+                  << " LUT; this build supports 64x64, 128x128 and 256x256\n";
+        return false;
+    }
+    if (header.payload_offset < sizeof(header) || header.payload_offset % lut_file_page_size != 0 ||
+        header.payload_offset + std::size_t{header.payload_bytes} > file_size || !std::isfinite(header.chroma_threshold) ||
+        !(header.chroma_threshold > 0.f)) {
+        std::cerr << "ERROR: " << path << " is damaged\n";
+        return false;
+    }
+    const chroma_lut_ref mapped_table{table_at(static_cast<const uint8_t *>(mapping) + header.payload_offset, header.lut_blocks)};
+    // WHY check on every start? Hashing even 128 KiB takes well under a millisecond; a torn copy
+    // would misclassify silently.
+    if (table_checksum(table_bytes(mapped_table)) != header.checksum) {
+        std::cerr << "ERROR: " << path << " is damaged (checksum mismatch)\n";
+        return false;
+    }
+    threshold = header.chroma_threshold;
+    table = mapped_table;
+    return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+#include "lut.hh" // For chroma_lut_ref
+
+// Writes `lut`, the block LUT of any resolution for `chroma_threshold`, to `path` in the format
+// chroma_lut_file reads (--dump-lut with --lut-file). Returns false after printing an error.
+// WHY replace the file by renaming? Other cpix processes may have the old file mapped; truncating
+// it under them would crash them, while a rename leaves their mapping intact.
+bool write_chroma_lut_file(const std::string &path, float chroma_threshold, chroma_lut_ref lut);
+
+// A block LUT file mapped read-only (--lut-file FILE).
+// WHY map it? Many short-lived cpix processes can then share one copy of a table through the page
+// cache, with no generation at startup and no rebuild for a new threshold.
+//
+// The file holds a header (magic, version, threshold, table geometry and a checksum of the table)
+// and the table itself at a page-aligned offset, in native byte order.
+class chroma_lut_file {
+  public:
+    chroma_lut_file() = default;
+    ~chroma_lut_file();
+
+    chroma_lut_file(const chroma_lut_file &) = delete;
+    chroma_lut_file &operator=(const chroma_lut_file &) = delete;
+
+    // Maps `path` and checks its header and checksum. Returns false (after printing an error) when
+    // it cannot be mapped, is not a LUT file of this version, or holds a table size this build lacks.
+    bool open(const std::string &path);
+
+    float chroma_threshold() const { return threshold; }
+
+    // The mapped table, at the resolution it was written with; valid while this object lives.
+    chroma_lut_ref lut() const { return table; }
+
+  private:
+    void *mapping{nullptr};
+    std::size_t mapping_size{0};
+    float threshold{0.f};
+    chroma_lut_ref table{};
+};
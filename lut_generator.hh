@@ -0,0 +1,544 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <bit> // WHY: For bit_cast in cube_root.
+#include <cstddef>
+#include <cstdint>
+#include <utility> // WHY: For exchange in generate_chroma_lut_row.
+
+#include "lut.hh" // For chroma_lut
+
+// The block LUT generator, constexpr from the sRGB tables up, shared by lut.cc (tables generated
+// at run time) and lut_presets.cc (the presets, generated at compile time).
+// WHY a header of its own? The presets take the compiler a minute or more to evaluate; keeping
+// them in a unit that only depends on this file lets lut.cc rebuild in seconds.
+
+// Cube root rounded to the nearest float, usable in constant expressions.
+// WHY not std::cbrt? It is not constexpr, and glibc's float version is one ulp off for about a
+// tenth of the inputs, so tables built at compile time and at run time would disagree.
+// WHY Halley's method in double? From a guess that divides the exponent bits by 3, two steps
+// give the correctly rounded result for every float f_xyz_transfer_float() passes in (checked
+// against std::cbrt in double for all floats in [0.008856, 2)), run faster than libm's cbrtf,
+// and keep the compile-time evaluation of the preset LUTs short.
+constexpr float cube_root(const float v)
+{
+    const double v_double{v};
+    double root{std::bit_cast<double>(std::bit_cast<uint64_t>(v_double) / 3 + 0x2A9F7893782DA1CE)};
+    for (int i = 0; i < 2; ++i) {
+        const double cube{root * root * root};
+        root *= (cube + 2 * v_double) / (2 * cube + v_double);
+    }
+    return static_cast<float>(root);
+}
+
+// Non-linear transfer function for XYZ to LAB (float version).
+// WHY float? Used in the optimized squared chroma calculation which uses float LUTs.
+constexpr float f_xyz_transfer_float(const float v)
+{
+    constexpr float epsilon{0.008856f}; // Standard threshold (delta^3)
+    constexpr float ratio{7.787f};      // Standard constant (kappa / 116)
+    constexpr float delta{16.0f / 116.0f};
+    // Note: Some variations exist for kappa, this version uses 7.787 directly.
+    return (v > epsilon) ? cube_root(v) : (ratio * v + delta);
+}
+
+// --- Precomputed sRGB [0-255] to XYZ component contributions ---
+// WHY constexpr arrays? These large tables are computed at compile time
+// and contain the contribution of each R, G, or B value (0-255) to the final X, Y, Z values.
+// This avoids repeated sRGB->linear->matrix multiplication at runtime.
+// Division by Xn, Yn, Zn is pre-applied.
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Rx = {
+    0.000000e+00f, 1.317155e-04f, 2.634311e-04f, 3.951466e-04f, 5.268621e-04f, 6.585776e-04f, 7.902932e-04f, 9.220086e-04f,
+    1.053724e-03f, 1.185440e-03f, 1.317155e-03f, 1.452229e-03f, 1.595420e-03f, 1.746526e-03f, 1.905666e-03f, 2.072959e-03f,
+    2.248519e-03f, 2.432459e-03f, 2.624891e-03f, 2.825921e-03f, 3.035658e-03f, 3.254205e-03f, 3.481664e-03f, 3.718138e-03f,
+    3.963724e-03f, 4.218522e-03f, 4.482626e-03f, 4.756132e-03f, 5.039133e-03f, 5.331721e-03f, 5.633987e-03f, 5.946018e-03f,
+    6.267905e-03f, 6.599734e-03f, 6.941591e-03f, 7.293560e-03f, 7.655725e-03f, 8.028169e-03f, 8.410974e-03f, 8.804221e-03f,
+    9.207987e-03f, 9.622357e-03f, 1.004740e-02f, 1.048320e-02f, 1.092984e-02f, 1.138738e-02f, 1.185590e-02f, 1.233548e-02f,
+    1.282619e-02f, 1.332810e-02f, 1.384128e-02f, 1.436581e-02f, 1.490176e-02f, 1.544919e-02f, 1.600817e-02f, 1.657878e-02f,
+    1.716109e-02f, 1.775515e-02f, 1.836104e-02f, 1.897881e-02f, 1.960855e-02f, 2.025031e-02f, 2.090416e-02f, 2.157016e-02f,
+    2.224838e-02f, 2.293888e-02f, 2.364171e-02f, 2.435695e-02f, 2.508466e-02f, 2.582490e-02f, 2.657772e-02f, 2.734319e-02f,
+    2.812137e-02f, 2.891232e-02f, 2.971610e-02f, 3.053276e-02f, 3.136237e-02f, 3.220497e-02f, 3.306064e-02f, 3.392943e-02f,
+    3.481139e-02f, 3.570658e-02f, 3.661505e-02f, 3.753687e-02f, 3.847209e-02f, 3.942075e-02f, 4.038293e-02f, 4.135867e-02f,
+    4.234802e-02f, 4.335105e-02f, 4.436779e-02f, 4.539832e-02f, 4.644267e-02f, 4.750090e-02f, 4.857307e-02f, 4.965923e-02f,
+    5.075942e-02f, 5.187370e-02f, 5.300212e-02f, 5.414472e-02f, 5.530158e-02f, 5.647272e-02f, 5.765820e-02f, 5.885808e-02f,
+    6.007239e-02f, 6.130120e-02f, 6.254455e-02f, 6.380247e-02f, 6.507504e-02f, 6.636229e-02f, 6.766428e-02f, 6.898104e-02f,
+    7.031263e-02f, 7.165911e-02f, 7.302050e-02f, 7.439686e-02f, 7.578824e-02f, 7.719467e-02f, 7.861621e-02f, 8.005291e-02f,
+    8.150481e-02f, 8.297197e-02f, 8.445440e-02f, 8.595218e-02f, 8.746532e-02f, 8.899391e-02f, 9.053796e-02f, 9.209753e-02f,
+    9.367266e-02f, 9.526338e-02f, 9.686977e-02f, 9.849183e-02f, 1.001296e-01f, 1.017832e-01f, 1.034526e-01f, 1.051379e-01f,
+    1.068390e-01f, 1.085562e-01f, 1.102893e-01f, 1.120384e-01f, 1.138037e-01f, 1.155850e-01f, 1.173825e-01f, 1.191962e-01f,
+    1.210262e-01f, 1.228724e-01f, 1.247349e-01f, 1.266139e-01f, 1.285092e-01f, 1.304210e-01f, 1.323492e-01f, 1.342940e-01f,
+    1.362554e-01f, 1.382333e-01f, 1.402280e-01f, 1.422393e-01f, 1.442673e-01f, 1.463121e-01f, 1.483737e-01f, 1.504522e-01f,
+    1.525476e-01f, 1.546598e-01f, 1.567891e-01f, 1.589353e-01f, 1.610986e-01f, 1.632789e-01f, 1.654764e-01f, 1.676910e-01f,
+    1.699229e-01f, 1.721719e-01f, 1.744382e-01f, 1.767219e-01f, 1.790228e-01f, 1.813412e-01f, 1.836770e-01f, 1.860302e-01f,
+    1.884010e-01f, 1.907892e-01f, 1.931950e-01f, 1.956185e-01f, 1.980595e-01f, 2.005183e-01f, 2.029948e-01f, 2.054890e-01f,
+    2.080010e-01f, 2.105308e-01f, 2.130785e-01f, 2.156440e-01f, 2.182276e-01f, 2.208290e-01f, 2.234485e-01f, 2.260860e-01f,
+    2.287416e-01f, 2.314153e-01f, 2.341071e-01f, 2.368171e-01f, 2.395453e-01f, 2.422918e-01f, 2.450565e-01f, 2.478396e-01f,
+    2.506410e-01f, 2.534608e-01f, 2.562990e-01f, 2.591557e-01f, 2.620308e-01f, 2.649245e-01f, 2.678368e-01f, 2.707676e-01f,
+    2.737170e-01f, 2.766851e-01f, 2.796719e-01f, 2.826774e-01f, 2.857018e-01f, 2.887448e-01f, 2.918067e-01f, 2.948874e-01f,
+    2.979870e-01f, 3.011056e-01f, 3.042431e-01f, 3.073996e-01f, 3.105752e-01f, 3.137697e-01f, 3.169834e-01f, 3.202162e-01f,
+    3.234681e-01f, 3.267392e-01f, 3.300296e-01f, 3.333392e-01f, 3.366680e-01f, 3.400162e-01f, 3.433837e-01f, 3.467706e-01f,
+    3.501769e-01f, 3.536026e-01f, 3.570478e-01f, 3.605126e-01f, 3.639968e-01f, 3.675006e-01f, 3.710240e-01f, 3.745670e-01f,
+    3.781297e-01f, 3.817121e-01f, 3.853142e-01f, 3.889360e-01f, 3.925776e-01f, 3.962391e-01f, 3.999204e-01f, 4.036216e-01f,
+    4.073426e-01f, 4.110836e-01f, 4.148446e-01f, 4.186256e-01f, 4.224266e-01f, 4.262476e-01f, 4.300887e-01f, 4.339499e-01f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Ry = {
+    0.000000e+00f, 6.455197e-05f, 1.291039e-04f, 1.936559e-04f, 2.582079e-04f, 3.227598e-04f, 3.873118e-04f, 4.518637e-04f,
+    5.164157e-04f, 5.809677e-04f, 6.455196e-04f, 7.117175e-04f, 7.818935e-04f, 8.559483e-04f, 9.339408e-04f, 1.015929e-03f,
+    1.101968e-03f, 1.192115e-03f, 1.286423e-03f, 1.384945e-03f, 1.487734e-03f, 1.594841e-03f, 1.706316e-03f, 1.822208e-03f,
+    1.942567e-03f, 2.067439e-03f, 2.196874e-03f, 2.330915e-03f, 2.469610e-03f, 2.613003e-03f, 2.761139e-03f, 2.914062e-03f,
+    3.071814e-03f, 3.234439e-03f, 3.401978e-03f, 3.574473e-03f, 3.751966e-03f, 3.934496e-03f, 4.122103e-03f, 4.314827e-03f,
+    4.512708e-03f, 4.715784e-03f, 4.924094e-03f, 5.137674e-03f, 5.356562e-03f, 5.580797e-03f, 5.810414e-03f, 6.045449e-03f,
+    6.285938e-03f, 6.531917e-03f, 6.783422e-03f, 7.040487e-03f, 7.303147e-03f, 7.571435e-03f, 7.845386e-03f, 8.125035e-03f,
+    8.410413e-03f, 8.701554e-03f, 8.998491e-03f, 9.301256e-03f, 9.609881e-03f, 9.924400e-03f, 1.024484e-02f, 1.057124e-02f,
+    1.090362e-02f, 1.124203e-02f, 1.158648e-02f, 1.193701e-02f, 1.229365e-02f, 1.265643e-02f, 1.302538e-02f, 1.340052e-02f,
+    1.378190e-02f, 1.416953e-02f, 1.456345e-02f, 1.496369e-02f, 1.537026e-02f, 1.578321e-02f, 1.620257e-02f, 1.662835e-02f,
+    1.706058e-02f, 1.749930e-02f, 1.794453e-02f, 1.839630e-02f, 1.885464e-02f, 1.931957e-02f, 1.979112e-02f, 2.026932e-02f,
+    2.075418e-02f, 2.124575e-02f, 2.174405e-02f, 2.224909e-02f, 2.276091e-02f, 2.327954e-02f, 2.380499e-02f, 2.433730e-02f,
+    2.487649e-02f, 2.542258e-02f, 2.597561e-02f, 2.653559e-02f, 2.710254e-02f, 2.767650e-02f, 2.825749e-02f, 2.884554e-02f,
+    2.944065e-02f, 3.004287e-02f, 3.065222e-02f, 3.126872e-02f, 3.189239e-02f, 3.252325e-02f, 3.316133e-02f, 3.380666e-02f,
+    3.445926e-02f, 3.511914e-02f, 3.578634e-02f, 3.646088e-02f, 3.714277e-02f, 3.783205e-02f, 3.852873e-02f, 3.923283e-02f,
+    3.994439e-02f, 4.066342e-02f, 4.138994e-02f, 4.212398e-02f, 4.286555e-02f, 4.361469e-02f, 4.437141e-02f, 4.513573e-02f,
+    4.590768e-02f, 4.668728e-02f, 4.747454e-02f, 4.826949e-02f, 4.907216e-02f, 4.988255e-02f, 5.070070e-02f, 5.152663e-02f,
+    5.236035e-02f, 5.320189e-02f, 5.405126e-02f, 5.490850e-02f, 5.577361e-02f, 5.664662e-02f, 5.752755e-02f, 5.841642e-02f,
+    5.931326e-02f, 6.021806e-02f, 6.113088e-02f, 6.205171e-02f, 6.298058e-02f, 6.391752e-02f, 6.486253e-02f, 6.581566e-02f,
+    6.677689e-02f, 6.774627e-02f, 6.872381e-02f, 6.970952e-02f, 7.070343e-02f, 7.170556e-02f, 7.271593e-02f, 7.373456e-02f,
+    7.476146e-02f, 7.579665e-02f, 7.684016e-02f, 7.789201e-02f, 7.895220e-02f, 8.002076e-02f, 8.109771e-02f, 8.218307e-02f,
+    8.327685e-02f, 8.437908e-02f, 8.548978e-02f, 8.660896e-02f, 8.773664e-02f, 8.887283e-02f, 9.001756e-02f, 9.117085e-02f,
+    9.233271e-02f, 9.350317e-02f, 9.468223e-02f, 9.586992e-02f, 9.706626e-02f, 9.827126e-02f, 9.948494e-02f, 1.007073e-01f,
+    1.019384e-01f, 1.031782e-01f, 1.044268e-01f, 1.056842e-01f, 1.069503e-01f, 1.082253e-01f, 1.095090e-01f, 1.108016e-01f,
+    1.121031e-01f, 1.134134e-01f, 1.147327e-01f, 1.160608e-01f, 1.173979e-01f, 1.187439e-01f, 1.200988e-01f, 1.214628e-01f,
+    1.228357e-01f, 1.242177e-01f, 1.256086e-01f, 1.270086e-01f, 1.284177e-01f, 1.298359e-01f, 1.312631e-01f, 1.326995e-01f,
+    1.341450e-01f, 1.355996e-01f, 1.370634e-01f, 1.385363e-01f, 1.400185e-01f, 1.415098e-01f, 1.430104e-01f, 1.445203e-01f,
+    1.460394e-01f, 1.475677e-01f, 1.491054e-01f, 1.506523e-01f, 1.522086e-01f, 1.537742e-01f, 1.553492e-01f, 1.569335e-01f,
+    1.585273e-01f, 1.601304e-01f, 1.617430e-01f, 1.633649e-01f, 1.649964e-01f, 1.666373e-01f, 1.682876e-01f, 1.699475e-01f,
+    1.716169e-01f, 1.732958e-01f, 1.749842e-01f, 1.766822e-01f, 1.783898e-01f, 1.801070e-01f, 1.818338e-01f, 1.835701e-01f,
+    1.853162e-01f, 1.870718e-01f, 1.888372e-01f, 1.906122e-01f, 1.923969e-01f, 1.941913e-01f, 1.959955e-01f, 1.978094e-01f,
+    1.996330e-01f, 2.014664e-01f, 2.033096e-01f, 2.051626e-01f, 2.070254e-01f, 2.088981e-01f, 2.107806e-01f, 2.126729e-01f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Rz = {
+    0.000000e+00f, 5.389602e-06f, 1.077920e-05f, 1.616881e-05f, 2.155841e-05f, 2.694801e-05f, 3.233761e-05f, 3.772721e-05f,
+    4.311682e-05f, 4.850642e-05f, 5.389602e-05f, 5.942304e-05f, 6.528221e-05f, 7.146522e-05f, 7.797701e-05f, 8.482237e-05f,
+    9.200603e-05f, 9.953260e-05f, 1.074066e-04f, 1.156325e-04f, 1.242146e-04f, 1.331572e-04f, 1.424645e-04f, 1.521406e-04f,
+    1.621897e-04f, 1.726156e-04f, 1.834224e-04f, 1.946138e-04f, 2.061938e-04f, 2.181661e-04f, 2.305343e-04f, 2.433022e-04f,
+    2.564733e-04f, 2.700512e-04f, 2.840395e-04f, 2.984416e-04f, 3.132608e-04f, 3.285007e-04f, 3.441645e-04f, 3.602556e-04f,
+    3.767771e-04f, 3.937325e-04f, 4.111247e-04f, 4.289570e-04f, 4.472326e-04f, 4.659545e-04f, 4.851257e-04f, 5.047494e-04f,
+    5.248284e-04f, 5.453659e-04f, 5.663646e-04f, 5.878276e-04f, 6.097577e-04f, 6.321577e-04f, 6.550306e-04f, 6.783791e-04f,
+    7.022060e-04f, 7.265141e-04f, 7.513061e-04f, 7.765848e-04f, 8.023526e-04f, 8.286125e-04f, 8.553670e-04f, 8.826188e-04f,
+    9.103704e-04f, 9.386246e-04f, 9.673836e-04f, 9.966502e-04f, 1.026427e-03f, 1.056716e-03f, 1.087521e-03f, 1.118843e-03f,
+    1.150685e-03f, 1.183049e-03f, 1.215938e-03f, 1.249355e-03f, 1.283301e-03f, 1.317779e-03f, 1.352792e-03f, 1.388342e-03f,
+    1.424430e-03f, 1.461060e-03f, 1.498233e-03f, 1.535953e-03f, 1.574220e-03f, 1.613038e-03f, 1.652409e-03f, 1.692335e-03f,
+    1.732818e-03f, 1.773860e-03f, 1.815464e-03f, 1.857631e-03f, 1.900365e-03f, 1.943666e-03f, 1.987538e-03f, 2.031981e-03f,
+    2.076999e-03f, 2.122594e-03f, 2.168767e-03f, 2.215521e-03f, 2.262858e-03f, 2.310779e-03f, 2.359287e-03f, 2.408385e-03f,
+    2.458073e-03f, 2.508353e-03f, 2.559229e-03f, 2.610702e-03f, 2.662774e-03f, 2.715446e-03f, 2.768721e-03f, 2.822601e-03f,
+    2.877088e-03f, 2.932184e-03f, 2.987890e-03f, 3.044209e-03f, 3.101141e-03f, 3.158691e-03f, 3.216858e-03f, 3.275645e-03f,
+    3.335055e-03f, 3.395089e-03f, 3.455748e-03f, 3.517034e-03f, 3.578950e-03f, 3.641498e-03f, 3.704678e-03f, 3.768493e-03f,
+    3.832945e-03f, 3.898035e-03f, 3.963766e-03f, 4.030139e-03f, 4.097155e-03f, 4.164817e-03f, 4.233127e-03f, 4.302085e-03f,
+    4.371694e-03f, 4.441957e-03f, 4.512873e-03f, 4.584446e-03f, 4.656676e-03f, 4.729566e-03f, 4.803117e-03f, 4.877331e-03f,
+    4.952210e-03f, 5.027754e-03f, 5.103967e-03f, 5.180850e-03f, 5.258404e-03f, 5.336631e-03f, 5.415533e-03f, 5.495111e-03f,
+    5.575367e-03f, 5.656302e-03f, 5.737919e-03f, 5.820219e-03f, 5.903203e-03f, 5.986874e-03f, 6.071232e-03f, 6.156280e-03f,
+    6.242018e-03f, 6.328449e-03f, 6.415574e-03f, 6.503395e-03f, 6.591913e-03f, 6.681130e-03f, 6.771048e-03f, 6.861667e-03f,
+    6.952989e-03f, 7.045018e-03f, 7.137752e-03f, 7.231195e-03f, 7.325348e-03f, 7.420211e-03f, 7.515788e-03f, 7.612079e-03f,
+    7.709085e-03f, 7.806810e-03f, 7.905252e-03f, 8.004416e-03f, 8.104301e-03f, 8.204909e-03f, 8.306243e-03f, 8.408302e-03f,
+    8.511089e-03f, 8.614606e-03f, 8.718853e-03f, 8.823832e-03f, 8.929546e-03f, 9.035994e-03f, 9.143178e-03f, 9.251102e-03f,
+    9.359763e-03f, 9.469166e-03f, 9.579313e-03f, 9.690202e-03f, 9.801837e-03f, 9.914218e-03f, 1.002735e-02f, 1.014123e-02f,
+    1.025586e-02f, 1.037124e-02f, 1.048737e-02f, 1.060426e-02f, 1.072191e-02f, 1.084032e-02f, 1.095948e-02f, 1.107940e-02f,
+    1.120009e-02f, 1.132154e-02f, 1.144376e-02f, 1.156674e-02f, 1.169049e-02f, 1.181500e-02f, 1.194029e-02f, 1.206635e-02f,
+    1.219319e-02f, 1.232079e-02f, 1.244918e-02f, 1.257833e-02f, 1.270827e-02f, 1.283899e-02f, 1.297049e-02f, 1.310277e-02f,
+    1.323583e-02f, 1.336968e-02f, 1.350432e-02f, 1.363974e-02f, 1.377595e-02f, 1.391296e-02f, 1.405075e-02f, 1.418933e-02f,
+    1.432871e-02f, 1.446889e-02f, 1.460986e-02f, 1.475164e-02f, 1.489420e-02f, 1.503757e-02f, 1.518175e-02f, 1.532672e-02f,
+    1.547250e-02f, 1.561909e-02f, 1.576648e-02f, 1.591468e-02f, 1.606369e-02f, 1.621351e-02f, 1.636415e-02f, 1.651559e-02f,
+    1.666785e-02f, 1.682093e-02f, 1.697482e-02f, 1.712953e-02f, 1.728506e-02f, 1.744141e-02f, 1.759859e-02f, 1.775658e-02f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Gx = {
+    0.000000e+00f, 1.141898e-04f, 2.283796e-04f, 3.425695e-04f, 4.567593e-04f, 5.709491e-04f, 6.851389e-04f, 7.993287e-04f,
+    9.135186e-04f, 1.027708e-03f, 1.141898e-03f, 1.259000e-03f, 1.383138e-03f, 1.514138e-03f, 1.652103e-03f, 1.797137e-03f,
+    1.949337e-03f, 2.108803e-03f, 2.275630e-03f, 2.449912e-03f, 2.631742e-03f, 2.821209e-03f, 3.018404e-03f, 3.223413e-03f,
+    3.436322e-03f, 3.657217e-03f, 3.886180e-03f, 4.123295e-03f, 4.368640e-03f, 4.622297e-03f, 4.884344e-03f, 5.154858e-03f,
+    5.433915e-03f, 5.721592e-03f, 6.017962e-03f, 6.323099e-03f, 6.637076e-03f, 6.959964e-03f, 7.291834e-03f, 7.632755e-03f,
+    7.982799e-03f, 8.342032e-03f, 8.710523e-03f, 9.088337e-03f, 9.475543e-03f, 9.872205e-03f, 1.027839e-02f, 1.069415e-02f,
+    1.111957e-02f, 1.155470e-02f, 1.199960e-02f, 1.245434e-02f, 1.291897e-02f, 1.339356e-02f, 1.387817e-02f, 1.437286e-02f,
+    1.487768e-02f, 1.539270e-02f, 1.591797e-02f, 1.645355e-02f, 1.699949e-02f, 1.755586e-02f, 1.812271e-02f, 1.870010e-02f,
+    1.928807e-02f, 1.988669e-02f, 2.049601e-02f, 2.111609e-02f, 2.174697e-02f, 2.238871e-02f, 2.304136e-02f, 2.370499e-02f,
+    2.437962e-02f, 2.506533e-02f, 2.576216e-02f, 2.647016e-02f, 2.718938e-02f, 2.791987e-02f, 2.866169e-02f, 2.941487e-02f,
+    3.017948e-02f, 3.095556e-02f, 3.174315e-02f, 3.254232e-02f, 3.335310e-02f, 3.417554e-02f, 3.500969e-02f, 3.585560e-02f,
+    3.671331e-02f, 3.758287e-02f, 3.846434e-02f, 3.935774e-02f, 4.026314e-02f, 4.118057e-02f, 4.211007e-02f, 4.305171e-02f,
+    4.400551e-02f, 4.497153e-02f, 4.594980e-02f, 4.694038e-02f, 4.794330e-02f, 4.895861e-02f, 4.998636e-02f, 5.102659e-02f,
+    5.207933e-02f, 5.314463e-02f, 5.422254e-02f, 5.531310e-02f, 5.641634e-02f, 5.753231e-02f, 5.866106e-02f, 5.980262e-02f,
+    6.095703e-02f, 6.212435e-02f, 6.330460e-02f, 6.449782e-02f, 6.570406e-02f, 6.692336e-02f, 6.815576e-02f, 6.940130e-02f,
+    7.066001e-02f, 7.193194e-02f, 7.321713e-02f, 7.451561e-02f, 7.582743e-02f, 7.715262e-02f, 7.849123e-02f, 7.984329e-02f,
+    8.120883e-02f, 8.258791e-02f, 8.398055e-02f, 8.538678e-02f, 8.680666e-02f, 8.824022e-02f, 8.968750e-02f, 9.114853e-02f,
+    9.262335e-02f, 9.411199e-02f, 9.561450e-02f, 9.713092e-02f, 9.866127e-02f, 1.002056e-01f, 1.017639e-01f, 1.033363e-01f,
+    1.049227e-01f, 1.065233e-01f, 1.081381e-01f, 1.097670e-01f, 1.114101e-01f, 1.130675e-01f, 1.147392e-01f, 1.164252e-01f,
+    1.181256e-01f, 1.198404e-01f, 1.215696e-01f, 1.233133e-01f, 1.250715e-01f, 1.268443e-01f, 1.286315e-01f, 1.304335e-01f,
+    1.322500e-01f, 1.340812e-01f, 1.359272e-01f, 1.377878e-01f, 1.396632e-01f, 1.415535e-01f, 1.434586e-01f, 1.453785e-01f,
+    1.473134e-01f, 1.492632e-01f, 1.512280e-01f, 1.532077e-01f, 1.552026e-01f, 1.572125e-01f, 1.592374e-01f, 1.612776e-01f,
+    1.633328e-01f, 1.654033e-01f, 1.674891e-01f, 1.695900e-01f, 1.717063e-01f, 1.738379e-01f, 1.759848e-01f, 1.781472e-01f,
+    1.803249e-01f, 1.825182e-01f, 1.847268e-01f, 1.869510e-01f, 1.891908e-01f, 1.914461e-01f, 1.937171e-01f, 1.960036e-01f,
+    1.983059e-01f, 2.006238e-01f, 2.029575e-01f, 2.053069e-01f, 2.076721e-01f, 2.100531e-01f, 2.124500e-01f, 2.148627e-01f,
+    2.172914e-01f, 2.197360e-01f, 2.221966e-01f, 2.246732e-01f, 2.271658e-01f, 2.296744e-01f, 2.321992e-01f, 2.347400e-01f,
+    2.372970e-01f, 2.398702e-01f, 2.424596e-01f, 2.450652e-01f, 2.476871e-01f, 2.503252e-01f, 2.529797e-01f, 2.556505e-01f,
+    2.583377e-01f, 2.610413e-01f, 2.637614e-01f, 2.664979e-01f, 2.692509e-01f, 2.720204e-01f, 2.748065e-01f, 2.776091e-01f,
+    2.804283e-01f, 2.832642e-01f, 2.861167e-01f, 2.889860e-01f, 2.918719e-01f, 2.947746e-01f, 2.976940e-01f, 3.006303e-01f,
+    3.035833e-01f, 3.065533e-01f, 3.095401e-01f, 3.125438e-01f, 3.155644e-01f, 3.186020e-01f, 3.216566e-01f, 3.247282e-01f,
+    3.278168e-01f, 3.309225e-01f, 3.340454e-01f, 3.371853e-01f, 3.403424e-01f, 3.435166e-01f, 3.467081e-01f, 3.499168e-01f,
+    3.531427e-01f, 3.563860e-01f, 3.596465e-01f, 3.629244e-01f, 3.662196e-01f, 3.695323e-01f, 3.728623e-01f, 3.762098e-01f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Gy = {
+    0.000000e+00f, 2.170680e-04f, 4.341360e-04f, 6.512040e-04f, 8.682720e-04f, 1.085340e-03f, 1.302408e-03f, 1.519476e-03f,
+    1.736544e-03f, 1.953612e-03f, 2.170680e-03f, 2.393282e-03f, 2.629262e-03f, 2.878285e-03f, 3.140549e-03f, 3.416249e-03f,
+    3.705573e-03f, 4.008708e-03f, 4.325836e-03f, 4.657136e-03f, 5.002783e-03f, 5.362949e-03f, 5.737804e-03f, 6.127514e-03f,
+    6.532243e-03f, 6.952150e-03f, 7.387395e-03f, 7.838136e-03f, 8.304522e-03f, 8.786709e-03f, 9.284845e-03f, 9.799075e-03f,
+    1.032955e-02f, 1.087640e-02f, 1.143979e-02f, 1.201983e-02f, 1.261668e-02f, 1.323047e-02f, 1.386134e-02f, 1.450941e-02f,
+    1.517482e-02f, 1.585770e-02f, 1.655818e-02f, 1.727638e-02f, 1.801244e-02f, 1.876647e-02f, 1.953860e-02f, 2.032894e-02f,
+    2.113764e-02f, 2.196479e-02f, 2.281052e-02f, 2.367495e-02f, 2.455819e-02f, 2.546036e-02f, 2.638157e-02f, 2.732194e-02f,
+    2.828158e-02f, 2.926059e-02f, 3.025910e-02f, 3.127720e-02f, 3.231501e-02f, 3.337264e-02f, 3.445019e-02f, 3.554776e-02f,
+    3.666547e-02f, 3.780341e-02f, 3.896169e-02f, 4.014041e-02f, 4.133968e-02f, 4.255959e-02f, 4.380025e-02f, 4.506175e-02f,
+    4.634420e-02f, 4.764768e-02f, 4.897231e-02f, 5.031818e-02f, 5.168537e-02f, 5.307400e-02f, 5.448414e-02f, 5.591591e-02f,
+    5.736938e-02f, 5.884466e-02f, 6.034183e-02f, 6.186099e-02f, 6.340224e-02f, 6.496565e-02f, 6.655133e-02f, 6.815935e-02f,
+    6.978980e-02f, 7.144279e-02f, 7.311840e-02f, 7.481671e-02f, 7.653781e-02f, 7.828178e-02f, 8.004873e-02f, 8.183871e-02f,
+    8.365183e-02f, 8.548817e-02f, 8.734781e-02f, 8.923084e-02f, 9.113733e-02f, 9.306739e-02f, 9.502107e-02f, 9.699848e-02f,
+    9.899967e-02f, 1.010248e-01f, 1.030738e-01f, 1.051469e-01f, 1.072441e-01f, 1.093655e-01f, 1.115112e-01f, 1.136812e-01f,
+    1.158757e-01f, 1.180947e-01f, 1.203382e-01f, 1.226065e-01f, 1.248995e-01f, 1.272173e-01f, 1.295600e-01f, 1.319277e-01f,
+    1.343204e-01f, 1.367383e-01f, 1.391814e-01f, 1.416497e-01f, 1.441434e-01f, 1.466625e-01f, 1.492071e-01f, 1.517773e-01f,
+    1.543731e-01f, 1.569946e-01f, 1.596420e-01f, 1.623151e-01f, 1.650143e-01f, 1.677394e-01f, 1.704905e-01f, 1.732679e-01f,
+    1.760714e-01f, 1.789012e-01f, 1.817574e-01f, 1.846400e-01f, 1.875491e-01f, 1.904848e-01f, 1.934471e-01f, 1.964361e-01f,
+    1.994518e-01f, 2.024944e-01f, 2.055639e-01f, 2.086604e-01f, 2.117839e-01f, 2.149346e-01f, 2.181123e-01f, 2.213174e-01f,
+    2.245497e-01f, 2.278094e-01f, 2.310966e-01f, 2.344112e-01f, 2.377534e-01f, 2.411233e-01f, 2.445208e-01f, 2.479462e-01f,
+    2.513993e-01f, 2.548803e-01f, 2.583894e-01f, 2.619264e-01f, 2.654915e-01f, 2.690847e-01f, 2.727062e-01f, 2.763559e-01f,
+    2.800339e-01f, 2.837404e-01f, 2.874753e-01f, 2.912387e-01f, 2.950307e-01f, 2.988514e-01f, 3.027008e-01f, 3.065790e-01f,
+    3.104859e-01f, 3.144218e-01f, 3.183866e-01f, 3.223805e-01f, 3.264033e-01f, 3.304554e-01f, 3.345366e-01f, 3.386471e-01f,
+    3.427869e-01f, 3.469560e-01f, 3.511547e-01f, 3.553827e-01f, 3.596404e-01f, 3.639276e-01f, 3.682445e-01f, 3.725911e-01f,
+    3.769675e-01f, 3.813738e-01f, 3.858100e-01f, 3.902760e-01f, 3.947722e-01f, 3.992983e-01f, 4.038547e-01f, 4.084412e-01f,
+    4.130579e-01f, 4.177050e-01f, 4.223824e-01f, 4.270902e-01f, 4.318285e-01f, 4.365973e-01f, 4.413967e-01f, 4.462266e-01f,
+    4.510874e-01f, 4.559788e-01f, 4.609011e-01f, 4.658542e-01f, 4.708382e-01f, 4.758532e-01f, 4.808992e-01f, 4.859763e-01f,
+    4.910845e-01f, 4.962239e-01f, 5.013946e-01f, 5.065965e-01f, 5.118298e-01f, 5.170945e-01f, 5.223906e-01f, 5.277182e-01f,
+    5.330774e-01f, 5.384683e-01f, 5.438908e-01f, 5.493450e-01f, 5.548310e-01f, 5.603488e-01f, 5.658984e-01f, 5.714801e-01f,
+    5.770937e-01f, 5.827394e-01f, 5.884171e-01f, 5.941269e-01f, 5.998690e-01f, 6.056433e-01f, 6.114498e-01f, 6.172888e-01f,
+    6.231601e-01f, 6.290639e-01f, 6.350002e-01f, 6.409690e-01f, 6.469705e-01f, 6.530045e-01f, 6.590713e-01f, 6.651708e-01f,
+    6.713032e-01f, 6.774684e-01f, 6.836664e-01f, 6.898975e-01f, 6.961616e-01f, 7.024587e-01f, 7.087889e-01f, 7.151522e-01f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Gz = {
+    0.000000e+00f, 3.322648e-05f, 6.645297e-05f, 9.967944e-05f, 1.329059e-04f, 1.661324e-04f, 1.993589e-04f, 2.325853e-04f,
+    2.658119e-04f, 2.990383e-04f, 3.322648e-04f, 3.663384e-04f, 4.024598e-04f, 4.405776e-04f, 4.807222e-04f, 5.229233e-04f,
+    5.672100e-04f, 6.136108e-04f, 6.621534e-04f, 7.128653e-04f, 7.657733e-04f, 8.209037e-04f, 8.782826e-04f, 9.379353e-04f,
+    9.998868e-04f, 1.064162e-03f, 1.130785e-03f, 1.199779e-03f, 1.271169e-03f, 1.344977e-03f, 1.421226e-03f, 1.499939e-03f,
+    1.581138e-03f, 1.664845e-03f, 1.751082e-03f, 1.839869e-03f, 1.931229e-03f, 2.025181e-03f, 2.121747e-03f, 2.220948e-03f,
+    2.322802e-03f, 2.427330e-03f, 2.534552e-03f, 2.644486e-03f, 2.757154e-03f, 2.872573e-03f, 2.990762e-03f, 3.111741e-03f,
+    3.235526e-03f, 3.362138e-03f, 3.491594e-03f, 3.623911e-03f, 3.759109e-03f, 3.897203e-03f, 4.038213e-03f, 4.182154e-03f,
+    4.329046e-03f, 4.478903e-03f, 4.631744e-03f, 4.787585e-03f, 4.946441e-03f, 5.108332e-03f, 5.273271e-03f, 5.441276e-03f,
+    5.612363e-03f, 5.786547e-03f, 5.963845e-03f, 6.144271e-03f, 6.327842e-03f, 6.514574e-03f, 6.704480e-03f, 6.897578e-03f,
+    7.093881e-03f, 7.293405e-03f, 7.496165e-03f, 7.702176e-03f, 7.911452e-03f, 8.124008e-03f, 8.339858e-03f, 8.559017e-03f,
+    8.781499e-03f, 9.007320e-03f, 9.236491e-03f, 9.469029e-03f, 9.704947e-03f, 9.944256e-03f, 1.018697e-02f, 1.043311e-02f,
+    1.068269e-02f, 1.093571e-02f, 1.119219e-02f, 1.145215e-02f, 1.171560e-02f, 1.198255e-02f, 1.225301e-02f, 1.252701e-02f,
+    1.280454e-02f, 1.308563e-02f, 1.337028e-02f, 1.365852e-02f, 1.395034e-02f, 1.424577e-02f, 1.454482e-02f, 1.484750e-02f,
+    1.515383e-02f, 1.546380e-02f, 1.577745e-02f, 1.609477e-02f, 1.641579e-02f, 1.674051e-02f, 1.706895e-02f, 1.740112e-02f,
+    1.773702e-02f, 1.807668e-02f, 1.842011e-02f, 1.876731e-02f, 1.911830e-02f, 1.947308e-02f, 1.983168e-02f, 2.019410e-02f,
+    2.056036e-02f, 2.093046e-02f, 2.130442e-02f, 2.168225e-02f, 2.206395e-02f, 2.244955e-02f, 2.283905e-02f, 2.323247e-02f,
+    2.362981e-02f, 2.403109e-02f, 2.443631e-02f, 2.484549e-02f, 2.525864e-02f, 2.567577e-02f, 2.609690e-02f, 2.652202e-02f,
+    2.695116e-02f, 2.738431e-02f, 2.782151e-02f, 2.826275e-02f, 2.870804e-02f, 2.915740e-02f, 2.961084e-02f, 3.006836e-02f,
+    3.052999e-02f, 3.099571e-02f, 3.146556e-02f, 3.193954e-02f, 3.241765e-02f, 3.289992e-02f, 3.338634e-02f, 3.387693e-02f,
+    3.437170e-02f, 3.487067e-02f, 3.537383e-02f, 3.588120e-02f, 3.639279e-02f, 3.690862e-02f, 3.742867e-02f, 3.795299e-02f,
+    3.848156e-02f, 3.901440e-02f, 3.955152e-02f, 4.009292e-02f, 4.063863e-02f, 4.118865e-02f, 4.174298e-02f, 4.230164e-02f,
+    4.286464e-02f, 4.343198e-02f, 4.400369e-02f, 4.457975e-02f, 4.516020e-02f, 4.574502e-02f, 4.633424e-02f, 4.692787e-02f,
+    4.752591e-02f, 4.812837e-02f, 4.873526e-02f, 4.934660e-02f, 4.996238e-02f, 5.058262e-02f, 5.120734e-02f, 5.183652e-02f,
+    5.247020e-02f, 5.310837e-02f, 5.375105e-02f, 5.439824e-02f, 5.504996e-02f, 5.570620e-02f, 5.636698e-02f, 5.703232e-02f,
+    5.770221e-02f, 5.837667e-02f, 5.905572e-02f, 5.973934e-02f, 6.042757e-02f, 6.112038e-02f, 6.181781e-02f, 6.251987e-02f,
+    6.322656e-02f, 6.393787e-02f, 6.465384e-02f, 6.537446e-02f, 6.609975e-02f, 6.682970e-02f, 6.756435e-02f, 6.830367e-02f,
+    6.904770e-02f, 6.979643e-02f, 7.054988e-02f, 7.130805e-02f, 7.207095e-02f, 7.283859e-02f, 7.361098e-02f, 7.438812e-02f,
+    7.517004e-02f, 7.595672e-02f, 7.674819e-02f, 7.754445e-02f, 7.834550e-02f, 7.915137e-02f, 7.996205e-02f, 8.077755e-02f,
+    8.159787e-02f, 8.242305e-02f, 8.325306e-02f, 8.408794e-02f, 8.492768e-02f, 8.577228e-02f, 8.662177e-02f, 8.747614e-02f,
+    8.833542e-02f, 8.919960e-02f, 9.006868e-02f, 9.094268e-02f, 9.182161e-02f, 9.270548e-02f, 9.359430e-02f, 9.448805e-02f,
+    9.538677e-02f, 9.629047e-02f, 9.719913e-02f, 9.811278e-02f, 9.903141e-02f, 9.995504e-02f, 1.008837e-01f, 1.018173e-01f,
+    1.027560e-01f, 1.036997e-01f, 1.046484e-01f, 1.056022e-01f, 1.065611e-01f, 1.075250e-01f, 1.084939e-01f, 1.094680e-01f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Bx = {
+    0.000000e+00f, 5.762166e-05f, 1.152433e-04f, 1.728650e-04f, 2.304866e-04f, 2.881083e-04f, 3.457299e-04f, 4.033516e-04f,
+    4.609732e-04f, 5.185949e-04f, 5.762166e-04f, 6.353073e-04f, 6.979493e-04f, 7.640535e-04f, 8.336726e-04f, 9.068582e-04f,
+    9.836606e-04f, 1.064129e-03f, 1.148312e-03f, 1.236257e-03f, 1.328011e-03f, 1.423619e-03f, 1.523125e-03f, 1.626575e-03f,
+    1.734012e-03f, 1.845479e-03f, 1.961017e-03f, 2.080668e-03f, 2.204472e-03f, 2.332471e-03f, 2.464703e-03f, 2.601208e-03f,
+    2.742023e-03f, 2.887189e-03f, 3.036741e-03f, 3.190717e-03f, 3.349154e-03f, 3.512087e-03f, 3.679553e-03f, 3.851587e-03f,
+    4.028223e-03f, 4.209497e-03f, 4.395442e-03f, 4.586092e-03f, 4.781481e-03f, 4.981642e-03f, 5.186606e-03f, 5.396408e-03f,
+    5.611078e-03f, 5.830650e-03f, 6.055153e-03f, 6.284619e-03f, 6.519079e-03f, 6.758564e-03f, 7.003104e-03f, 7.252729e-03f,
+    7.507469e-03f, 7.767354e-03f, 8.032411e-03f, 8.302672e-03f, 8.578163e-03f, 8.858914e-03f, 9.144953e-03f, 9.436309e-03f,
+    9.733009e-03f, 1.003508e-02f, 1.034255e-02f, 1.065545e-02f, 1.097380e-02f, 1.129763e-02f, 1.162697e-02f, 1.196184e-02f,
+    1.230227e-02f, 1.264829e-02f, 1.299992e-02f, 1.335718e-02f, 1.372011e-02f, 1.408873e-02f, 1.446306e-02f, 1.484312e-02f,
+    1.522895e-02f, 1.562057e-02f, 1.601801e-02f, 1.642127e-02f, 1.683040e-02f, 1.724542e-02f, 1.766634e-02f, 1.809320e-02f,
+    1.852601e-02f, 1.896480e-02f, 1.940960e-02f, 1.986042e-02f, 2.031730e-02f, 2.078024e-02f, 2.124929e-02f, 2.172445e-02f,
+    2.220575e-02f, 2.269321e-02f, 2.318686e-02f, 2.368672e-02f, 2.419281e-02f, 2.470515e-02f, 2.522376e-02f, 2.574867e-02f,
+    2.627990e-02f, 2.681747e-02f, 2.736139e-02f, 2.791170e-02f, 2.846841e-02f, 2.903155e-02f, 2.960113e-02f, 3.017717e-02f,
+    3.075970e-02f, 3.134875e-02f, 3.194431e-02f, 3.254643e-02f, 3.315512e-02f, 3.377039e-02f, 3.439228e-02f, 3.502079e-02f,
+    3.565595e-02f, 3.629778e-02f, 3.694631e-02f, 3.760154e-02f, 3.826350e-02f, 3.893221e-02f, 3.960769e-02f, 4.028995e-02f,
+    4.097902e-02f, 4.167492e-02f, 4.237766e-02f, 4.308727e-02f, 4.380376e-02f, 4.452715e-02f, 4.525747e-02f, 4.599472e-02f,
+    4.673893e-02f, 4.749012e-02f, 4.824831e-02f, 4.901351e-02f, 4.978574e-02f, 5.056503e-02f, 5.135138e-02f, 5.214483e-02f,
+    5.294537e-02f, 5.375304e-02f, 5.456785e-02f, 5.538983e-02f, 5.621897e-02f, 5.705532e-02f, 5.789888e-02f, 5.874967e-02f,
+    5.960771e-02f, 6.047301e-02f, 6.134561e-02f, 6.222549e-02f, 6.311270e-02f, 6.400725e-02f, 6.490913e-02f, 6.581841e-02f,
+    6.673506e-02f, 6.765911e-02f, 6.859059e-02f, 6.952950e-02f, 7.047588e-02f, 7.142971e-02f, 7.239105e-02f, 7.335988e-02f,
+    7.433624e-02f, 7.532013e-02f, 7.631158e-02f, 7.731061e-02f, 7.831722e-02f, 7.933143e-02f, 8.035326e-02f, 8.138274e-02f,
+    8.241986e-02f, 8.346465e-02f, 8.451713e-02f, 8.557730e-02f, 8.664521e-02f, 8.772083e-02f, 8.880422e-02f, 8.989536e-02f,
+    9.099429e-02f, 9.210102e-02f, 9.321555e-02f, 9.433790e-02f, 9.546812e-02f, 9.660618e-02f, 9.775212e-02f, 9.890596e-02f,
+    1.000677e-01f, 1.012373e-01f, 1.024150e-01f, 1.036005e-01f, 1.047940e-01f, 1.059955e-01f, 1.072050e-01f, 1.084225e-01f,
+    1.096480e-01f, 1.108816e-01f, 1.121233e-01f, 1.133730e-01f, 1.146308e-01f, 1.158967e-01f, 1.171707e-01f, 1.184528e-01f,
+    1.197431e-01f, 1.210416e-01f, 1.223482e-01f, 1.236630e-01f, 1.249861e-01f, 1.263173e-01f, 1.276568e-01f, 1.290046e-01f,
+    1.303605e-01f, 1.317248e-01f, 1.330974e-01f, 1.344783e-01f, 1.358675e-01f, 1.372650e-01f, 1.386709e-01f, 1.400851e-01f,
+    1.415077e-01f, 1.429388e-01f, 1.443782e-01f, 1.458261e-01f, 1.472823e-01f, 1.487471e-01f, 1.502202e-01f, 1.517019e-01f,
+    1.531921e-01f, 1.546907e-01f, 1.561979e-01f, 1.577136e-01f, 1.592378e-01f, 1.607707e-01f, 1.623121e-01f, 1.638620e-01f,
+    1.654206e-01f, 1.669878e-01f, 1.685636e-01f, 1.701480e-01f, 1.717411e-01f, 1.733429e-01f, 1.749534e-01f, 1.765725e-01f,
+    1.782004e-01f, 1.798370e-01f, 1.814823e-01f, 1.831363e-01f, 1.847991e-01f, 1.864707e-01f, 1.881511e-01f, 1.898403e-01f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> By = {
+    0.000000e+00f, 2.190706e-05f, 4.381413e-05f, 6.572119e-05f, 8.762825e-05f, 1.095353e-04f, 1.314424e-04f, 1.533494e-04f,
+    1.752565e-04f, 1.971636e-04f, 2.190706e-04f, 2.415362e-04f, 2.653519e-04f, 2.904840e-04f, 3.169524e-04f, 3.447766e-04f,
+    3.739760e-04f, 4.045692e-04f, 4.365745e-04f, 4.700102e-04f, 5.048938e-04f, 5.412427e-04f, 5.790740e-04f, 6.184045e-04f,
+    6.592507e-04f, 7.016289e-04f, 7.455550e-04f, 7.910448e-04f, 8.381138e-04f, 8.867773e-04f, 9.370504e-04f, 9.889479e-04f,
+    1.042484e-03f, 1.097675e-03f, 1.154533e-03f, 1.213072e-03f, 1.273308e-03f, 1.335253e-03f, 1.398922e-03f, 1.464327e-03f,
+    1.531482e-03f, 1.600400e-03f, 1.671094e-03f, 1.743577e-03f, 1.817862e-03f, 1.893960e-03f, 1.971886e-03f, 2.051650e-03f,
+    2.133265e-03f, 2.216743e-03f, 2.302096e-03f, 2.389337e-03f, 2.478476e-03f, 2.569525e-03f, 2.662496e-03f, 2.757401e-03f,
+    2.854250e-03f, 2.953055e-03f, 3.053826e-03f, 3.156576e-03f, 3.261314e-03f, 3.368053e-03f, 3.476802e-03f, 3.587572e-03f,
+    3.700373e-03f, 3.815217e-03f, 3.932114e-03f, 4.051074e-03f, 4.172107e-03f, 4.295224e-03f, 4.420434e-03f, 4.547748e-03f,
+    4.677176e-03f, 4.808727e-03f, 4.942412e-03f, 5.078240e-03f, 5.216221e-03f, 5.356365e-03f, 5.498680e-03f, 5.643177e-03f,
+    5.789866e-03f, 5.938755e-03f, 6.089853e-03f, 6.243171e-03f, 6.398717e-03f, 6.556501e-03f, 6.716531e-03f, 6.878817e-03f,
+    7.043367e-03f, 7.210191e-03f, 7.379297e-03f, 7.550695e-03f, 7.724393e-03f, 7.900399e-03f, 8.078723e-03f, 8.259374e-03f,
+    8.442358e-03f, 8.627687e-03f, 8.815367e-03f, 9.005407e-03f, 9.197815e-03f, 9.392601e-03f, 9.589772e-03f, 9.789336e-03f,
+    9.991302e-03f, 1.019568e-02f, 1.040247e-02f, 1.061169e-02f, 1.082335e-02f, 1.103745e-02f, 1.125399e-02f, 1.147300e-02f,
+    1.169447e-02f, 1.191842e-02f, 1.214484e-02f, 1.237376e-02f, 1.260518e-02f, 1.283910e-02f, 1.307553e-02f, 1.331448e-02f,
+    1.355597e-02f, 1.379998e-02f, 1.404654e-02f, 1.429565e-02f, 1.454732e-02f, 1.480156e-02f, 1.505837e-02f, 1.531776e-02f,
+    1.557973e-02f, 1.584430e-02f, 1.611148e-02f, 1.638126e-02f, 1.665366e-02f, 1.692869e-02f, 1.720634e-02f, 1.748664e-02f,
+    1.776958e-02f, 1.805517e-02f, 1.834343e-02f, 1.863435e-02f, 1.892794e-02f, 1.922422e-02f, 1.952318e-02f, 1.982484e-02f,
+    2.012919e-02f, 2.043626e-02f, 2.074604e-02f, 2.105855e-02f, 2.137378e-02f, 2.169175e-02f, 2.201246e-02f, 2.233592e-02f,
+    2.266214e-02f, 2.299112e-02f, 2.332286e-02f, 2.365739e-02f, 2.399469e-02f, 2.433479e-02f, 2.467767e-02f, 2.502337e-02f,
+    2.537187e-02f, 2.572318e-02f, 2.607732e-02f, 2.643428e-02f, 2.679408e-02f, 2.715672e-02f, 2.752221e-02f, 2.789055e-02f,
+    2.826175e-02f, 2.863581e-02f, 2.901275e-02f, 2.939256e-02f, 2.977526e-02f, 3.016086e-02f, 3.054935e-02f, 3.094074e-02f,
+    3.133504e-02f, 3.173226e-02f, 3.213240e-02f, 3.253547e-02f, 3.294147e-02f, 3.335041e-02f, 3.376230e-02f, 3.417714e-02f,
+    3.459493e-02f, 3.501570e-02f, 3.543943e-02f, 3.586614e-02f, 3.629583e-02f, 3.672851e-02f, 3.716419e-02f, 3.760286e-02f,
+    3.804453e-02f, 3.848923e-02f, 3.893694e-02f, 3.938767e-02f, 3.984143e-02f, 4.029822e-02f, 4.075805e-02f, 4.122094e-02f,
+    4.168687e-02f, 4.215586e-02f, 4.262792e-02f, 4.310304e-02f, 4.358124e-02f, 4.406252e-02f, 4.454689e-02f, 4.503434e-02f,
+    4.552490e-02f, 4.601856e-02f, 4.651532e-02f, 4.701521e-02f, 4.751821e-02f, 4.802433e-02f, 4.853359e-02f, 4.904598e-02f,
+    4.956152e-02f, 5.008020e-02f, 5.060203e-02f, 5.112702e-02f, 5.165518e-02f, 5.218651e-02f, 5.272101e-02f, 5.325868e-02f,
+    5.379955e-02f, 5.434361e-02f, 5.489086e-02f, 5.544131e-02f, 5.599497e-02f, 5.655184e-02f, 5.711193e-02f, 5.767524e-02f,
+    5.824178e-02f, 5.881155e-02f, 5.938456e-02f, 5.996082e-02f, 6.054032e-02f, 6.112308e-02f, 6.170909e-02f, 6.229838e-02f,
+    6.289092e-02f, 6.348675e-02f, 6.408586e-02f, 6.468824e-02f, 6.529392e-02f, 6.590290e-02f, 6.651518e-02f, 6.713075e-02f,
+    6.774964e-02f, 6.837185e-02f, 6.899738e-02f, 6.962623e-02f, 7.025842e-02f, 7.089394e-02f, 7.153280e-02f, 7.217500e-02f,
+};
+
+inline constexpr std::array<float, RGB_LUT_SIZE> Bz = {
+    0.000000e+00f, 2.649109e-04f, 5.298218e-04f, 7.947327e-04f, 1.059644e-03f, 1.324555e-03f, 1.589465e-03f, 1.854376e-03f,
+    2.119287e-03f, 2.384198e-03f, 2.649109e-03f, 2.920775e-03f, 3.208766e-03f, 3.512674e-03f, 3.832743e-03f, 4.169208e-03f,
+    4.522301e-03f, 4.892248e-03f, 5.279273e-03f, 5.683593e-03f, 6.105423e-03f, 6.544971e-03f, 7.002446e-03f, 7.478050e-03f,
+    7.971982e-03f, 8.484440e-03f, 9.015616e-03f, 9.565701e-03f, 1.013488e-02f, 1.072334e-02f, 1.133127e-02f, 1.195884e-02f,
+    1.260623e-02f, 1.327362e-02f, 1.396117e-02f, 1.466906e-02f, 1.539746e-02f, 1.614654e-02f, 1.691645e-02f, 1.770736e-02f,
+    1.851943e-02f, 1.935282e-02f, 2.020769e-02f, 2.108419e-02f, 2.198247e-02f, 2.290270e-02f, 2.384500e-02f, 2.480955e-02f,
+    2.579648e-02f, 2.680594e-02f, 2.783808e-02f, 2.889303e-02f, 2.997094e-02f, 3.107195e-02f, 3.219621e-02f, 3.334384e-02f,
+    3.451499e-02f, 3.570978e-02f, 3.692836e-02f, 3.817086e-02f, 3.943741e-02f, 4.072814e-02f, 4.204319e-02f, 4.338267e-02f,
+    4.474672e-02f, 4.613547e-02f, 4.754905e-02f, 4.898757e-02f, 5.045116e-02f, 5.193995e-02f, 5.345405e-02f, 5.499359e-02f,
+    5.655870e-02f, 5.814948e-02f, 5.976607e-02f, 6.140856e-02f, 6.307710e-02f, 6.477179e-02f, 6.649273e-02f, 6.824006e-02f,
+    7.001389e-02f, 7.181432e-02f, 7.364149e-02f, 7.549548e-02f, 7.737642e-02f, 7.928441e-02f, 8.121958e-02f, 8.318201e-02f,
+    8.517184e-02f, 8.718915e-02f, 8.923407e-02f, 9.130670e-02f, 9.340714e-02f, 9.553549e-02f, 9.769188e-02f, 9.987639e-02f,
+    1.020891e-01f, 1.043302e-01f, 1.065997e-01f, 1.088978e-01f, 1.112245e-01f, 1.135799e-01f, 1.159642e-01f, 1.183774e-01f,
+    1.208197e-01f, 1.232911e-01f, 1.257918e-01f, 1.283218e-01f, 1.308812e-01f, 1.334702e-01f, 1.360888e-01f, 1.387371e-01f,
+    1.414153e-01f, 1.441233e-01f, 1.468614e-01f, 1.496296e-01f, 1.524280e-01f, 1.552567e-01f, 1.581157e-01f, 1.610052e-01f,
+    1.639254e-01f, 1.668761e-01f, 1.698577e-01f, 1.728700e-01f, 1.759133e-01f, 1.789877e-01f, 1.820931e-01f, 1.852298e-01f,
+    1.883977e-01f, 1.915971e-01f, 1.948279e-01f, 1.980903e-01f, 2.013843e-01f, 2.047100e-01f, 2.080676e-01f, 2.114570e-01f,
+    2.148785e-01f, 2.183320e-01f, 2.218177e-01f, 2.253357e-01f, 2.288859e-01f, 2.324686e-01f, 2.360838e-01f, 2.397316e-01f,
+    2.434121e-01f, 2.471253e-01f, 2.508713e-01f, 2.546502e-01f, 2.584622e-01f, 2.623073e-01f, 2.661854e-01f, 2.700969e-01f,
+    2.740417e-01f, 2.780198e-01f, 2.820315e-01f, 2.860767e-01f, 2.901555e-01f, 2.942682e-01f, 2.984145e-01f, 3.025948e-01f,
+    3.068090e-01f, 3.110573e-01f, 3.153397e-01f, 3.196563e-01f, 3.240071e-01f, 3.283924e-01f, 3.328120e-01f, 3.372661e-01f,
+    3.417549e-01f, 3.462782e-01f, 3.508363e-01f, 3.554293e-01f, 3.600571e-01f, 3.647198e-01f, 3.694176e-01f, 3.741505e-01f,
+    3.789186e-01f, 3.837220e-01f, 3.885607e-01f, 3.934348e-01f, 3.983443e-01f, 4.032894e-01f, 4.082702e-01f, 4.132867e-01f,
+    4.183389e-01f, 4.234270e-01f, 4.285510e-01f, 4.337109e-01f, 4.389070e-01f, 4.441391e-01f, 4.494075e-01f, 4.547122e-01f,
+    4.600531e-01f, 4.654305e-01f, 4.708444e-01f, 4.762949e-01f, 4.817820e-01f, 4.873058e-01f, 4.928664e-01f, 4.984638e-01f,
+    5.040981e-01f, 5.097693e-01f, 5.154776e-01f, 5.212231e-01f, 5.270057e-01f, 5.328255e-01f, 5.386827e-01f, 5.445773e-01f,
+    5.505094e-01f, 5.564789e-01f, 5.624861e-01f, 5.685309e-01f, 5.746134e-01f, 5.807337e-01f, 5.868918e-01f, 5.930880e-01f,
+    5.993221e-01f, 6.055942e-01f, 6.119045e-01f, 6.182529e-01f, 6.246397e-01f, 6.310648e-01f, 6.375282e-01f, 6.440301e-01f,
+    6.505705e-01f, 6.571495e-01f, 6.637672e-01f, 6.704234e-01f, 6.771186e-01f, 6.838526e-01f, 6.906254e-01f, 6.974372e-01f,
+    7.042881e-01f, 7.111781e-01f, 7.181072e-01f, 7.250755e-01f, 7.320832e-01f, 7.391302e-01f, 7.462166e-01f, 7.533424e-01f,
+    7.605078e-01f, 7.677128e-01f, 7.749575e-01f, 7.822419e-01f, 7.895661e-01f, 7.969301e-01f, 8.043340e-01f, 8.117779e-01f,
+    8.192618e-01f, 8.267859e-01f, 8.343500e-01f, 8.419545e-01f, 8.495991e-01f, 8.572842e-01f, 8.650096e-01f, 8.727754e-01f,
+};
+
+// Optimized computation of *squared* CIELAB chroma from sRGB [0, 255].
+// Uses precomputed tables for sRGB -> XYZ conversion steps.
+// WHY constexpr? The preset LUTs (lut_presets.cc) are generated from it at compile time.
+constexpr float chroma_squared(const uint8_t r_srgb, const uint8_t g_srgb, const uint8_t b_srgb)
+{
+    // --- Sum contributions to get normalized XYZ ---
+    // WHY array indexing? Directly look up the precomputed contribution for each component.
+    const float X{Rx[r_srgb] + Gx[g_srgb] + Bx[b_srgb]};
+    const float Y{Ry[r_srgb] + Gy[g_srgb] + By[b_srgb]};
+    const float Z{Rz[r_srgb] + Gz[g_srgb] + Bz[b_srgb]};
+
+    // --- XYZ to LAB (float version) ---
+    const float fx{f_xyz_transfer_float(X)};
+    const float fy{f_xyz_transfer_float(Y)};
+    const float fz{f_xyz_transfer_float(Z)};
+
+    const float a_star{500.0f * (fx - fy)}; // WHY 500? Standard LAB coefficient.
+    const float b_star{200.0f * (fy - fz)}; // WHY 200? Standard LAB coefficient.
+
+    // --- Calculate Squared Chroma ---
+    // WHY return squared? Avoids expensive sqrt in the main pixel loop; comparison is done on squared values.
+    return a_star * a_star + b_star * b_star;
+}
+
+// Walks from B = `b` to the B where chroma is lowest for (r, g). `lowest_chroma_squared` holds
+// the chroma squared at `b` on entry and the lowest one on return.
+// WHY a walk? For every (R,G) pair, chroma falls strictly as B approaches its grayest value and
+// rises strictly after it (checked for all 65536 pairs; only the lowest value itself may repeat),
+// so going downhill cannot stop early. Starting from a nearby pair's grayest B, it takes a few steps.
+constexpr int grayest_b(const int r, const int g, int b, float &lowest_chroma_squared)
+{
+    for (const int step : {-1, 1}) {
+        bool moved{false};
+        while (b + step >= 0 && b + step <= 255) {
+            const float next{chroma_squared(r, g, b + step)};
+            if (!(next < lowest_chroma_squared))
+                break;
+            lowest_chroma_squared = next;
+            b += step;
+            moved = true;
+        }
+        if (moved)
+            break; // WHY? Having come downhill, the other side is uphill.
+    }
+    return b;
+}
+
+constexpr float square(const float v) { return v * v; }
+
+// Largest change of chroma between (R, G, B) and (R, G + 1, B), over all RGB values (measured:
+// 1.103), with a margin. The lowest chroma of a pair changes no faster along G.
+inline constexpr float max_chroma_step_along_g{1.25f};
+
+// How far along G a pair whose lowest chroma squared is `lowest_chroma_squared`, above the
+// threshold, is at least from the next pair with a gray B.
+// WHY count the steps instead of dividing the chroma gap? std::sqrt is not constexpr.
+constexpr int g_steps_to_gray(const float chroma_threshold, const float lowest_chroma_squared)
+{
+    int steps_to_gray{1};
+    while (square(chroma_threshold + (steps_to_gray + 1) * max_chroma_step_along_g) <= lowest_chroma_squared)
+        ++steps_to_gray;
+    return steps_to_gray;
+}
+
+// Widens [min_b_gray, max_b_gray] to hold every gray B of (r, g), given one of them, `b`.
+// WHY binary searches instead of a sweep over B? The gray B values form one interval around the
+// grayest B, which holds b: chroma only falls before the grayest B and only rises after it.
+// WHY probe first? Only a pair whose interval reaches past the range so far can widen it, and one
+// chroma value next to that range tells.
+constexpr void widen_gray_range(const int r, const int g, const int b, const float chroma_threshold_squared,
+                                       int &min_b_gray, int &max_b_gray)
+{
+    const auto gray = [&](const int b_candidate) {
+        // WHY compare squared? Faster than sqrt. Below the threshold means gray.
+        return chroma_squared(r, g, b_candidate) < chroma_threshold_squared;
+    };
+
+    int low{0};
+    int high{std::min(b, min_b_gray - 1)};
+    if (high >= 0 && (high == b || gray(high))) {
+        while (low < high) {
+            const int middle{(low + high) / 2};
+            if (gray(middle))
+                high = middle;
+            else
+                low = middle + 1;
+        }
+        min_b_gray = low;
+    }
+
+    low = std::max(b, max_b_gray + 1);
+    high = 255;
+    if (low <= 255 && (low == b || gray(low))) {
+        while (low < high) {
+            const int middle{(low + high + 1) / 2};
+            if (gray(middle))
+                low = middle;
+            else
+                high = middle - 1;
+        }
+        max_b_gray = low;
+    }
+}
+
+// WHY bit shift and OR? Pack min_b (high byte) and max_b (low byte) into one 16-bit value.
+// A block without gray B keeps min=255, max=0, so the check `b < minB || b > maxB` in the
+// kernels counts every B as colored.
+constexpr uint16_t pack_gray_range(const int min_b_gray, const int max_b_gray)
+{
+    return static_cast<uint16_t>(min_b_gray << 8 | max_b_gray);
+}
+
+// Fills row R_block of the LUT.
+template <std::size_t Blocks>
+constexpr void generate_chroma_lut_row(chroma_lut<Blocks> &lut, const int R_block, const float chroma_threshold)
+{
+    constexpr int block_size{256 / int{Blocks}};
+    const float chroma_threshold_squared{chroma_threshold * chroma_threshold};
+
+    // Min/max gray B of each block in the row; min=255, max=0 while a block has no gray B.
+    std::array<int, Blocks> min_b_gray{};
+    std::array<int, Blocks> max_b_gray{};
+    min_b_gray.fill(255);
+    max_b_gray.fill(0);
+
+    // The B settled on for each G in the previous R, or -1 where that R skipped G.
+    // WHY keep it? The grayest B of (R, G) is nearly that of (R - 1, G).
+    std::array<int, 256> previous_r_b{};
+    previous_r_b.fill(-1);
+
+    for (int r = R_block * block_size; r < (R_block + 1) * block_size; ++r) {
+        // The B settled on for the last two pairs of this R. WHY two? Without a previous R, the
+        // grayest B moves almost linearly along G, also across skipped pairs, so extrapolating
+        // from them lands near it.
+        int last_g{-1};
+        int last_b{r}; // WHY start on the diagonal? Gray pixels have R = G = B, roughly.
+        int previous_g{-1};
+        int previous_b{r};
+        for (int g = 0; g < 256;) {
+            int b{previous_r_b[g]};
+            if (b < 0)
+                b = previous_g < 0 ? last_b
+                                   : std::clamp(last_b + (last_b - previous_b) * (g - last_g) / (last_g - previous_g), 0, 255);
+            float b_chroma_squared{chroma_squared(r, g, b)};
+            // WHY only walk when B is not gray? Any gray B serves widen_gray_range(); the
+            // grayest one is needed only to tell whether the pair has a gray B at all.
+            if (!(b_chroma_squared < chroma_threshold_squared))
+                b = grayest_b(r, g, b, b_chroma_squared);
+            previous_g = std::exchange(last_g, g);
+            previous_b = std::exchange(last_b, b);
+            previous_r_b[g] = b;
+            if (!(b_chroma_squared < chroma_threshold_squared)) {
+                // Not even the grayest B is gray. WHY skip ahead? Far from the gray axis the
+                // next pairs cannot get below the threshold either; that is most of the row.
+                g += g_steps_to_gray(chroma_threshold, b_chroma_squared);
+                continue;
+            }
+            const int block{g / block_size};
+            widen_gray_range(r, g, b, chroma_threshold_squared, min_b_gray[block], max_b_gray[block]);
+            ++g;
+        }
+    }
+
+    for (std::size_t G_block = 0; G_block < Blocks; ++G_block) {
+        lut[R_block][G_block] = pack_gray_range(min_b_gray[G_block], max_b_gray[G_block]);
+    }
+}
+
+// Generates the LUT for a threshold on the calling thread; used at compile time for the presets.
+constexpr chroma_lut_t make_chroma_lut(const float chroma_threshold)
+{
+    chroma_lut_t lut{};
+    for (int R_block = 0; R_block < RG_LUT_BLOCKS; ++R_block)
+        generate_chroma_lut_row<RG_LUT_BLOCKS>(lut, R_block, chroma_threshold);
+    return lut;
+}
+
+// Returns the LUT built at compile time for a preset threshold, or null (lut_presets.cc).
+const chroma_lut_t *preset_chroma_lut(float chroma_threshold);
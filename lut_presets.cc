@@ -0,0 +1,35 @@
+// The block LUTs built into the binary, generated at compile time by lut_generator.hh.
+// WHY a unit of its own? Evaluating them is most of the build (see the Makefile); here they are
+// only rebuilt when the generator or the preset list changes.
+#include "lut_generator.hh"
+
+#include <array>
+#include <cstddef>
+
+// Thresholds whose LUTs are built into the binary: the default, --sepia (13) and the other
+// values in common use. `make PRESET_THRESHOLDS="..."` replaces the list.
+#ifndef CPIX_PRESET_THRESHOLDS
+#define CPIX_PRESET_THRESHOLDS 3, 5, 8, 10, 13, 20
+#endif
+static constexpr auto preset_thresholds{std::to_array<float>({CPIX_PRESET_THRESHOLDS})};
+
+// Returns the LUT built at compile time for a preset threshold, or null.
+// WHY compile time? These thresholds then cost nothing at startup, and the tables come from the
+// same code as generated ones instead of being pasted in from --dump-lut output.
+// WHY only 64x64? A finer table costs the compiler as many chroma evaluations again, and the
+// binary 4-16 times the space, for an option few runs use.
+const chroma_lut_t *preset_chroma_lut(const float chroma_threshold)
+{
+    static constexpr std::array<chroma_lut_t, preset_thresholds.size()> preset_luts{[] {
+        std::array<chroma_lut_t, preset_thresholds.size()> luts{};
+        for (std::size_t i = 0; i < preset_thresholds.size(); ++i)
+            luts[i] = make_chroma_lut(preset_thresholds[i]);
+        return luts;
+    }()};
+
+    for (std::size_t i = 0; i < preset_thresholds.size(); ++i) {
+        if (preset_thresholds[i] == chroma_threshold)
+            return &preset_luts[i];
+    }
+    return nullptr;
+}
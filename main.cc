@@ -1,13 +1,72 @@
 #include <CLI/CLI.hpp> // WHY: External library for easy command-line argument parsing.
+#include <algorithm>
 #include <atomic>
+#include <cmath> // WHY: For std::floor in --thresholds ranges.
 #include <iostream>
 #include <optional>
+#include <sstream> // WHY: For splitting the --thresholds list.
 #include <string>
-#include <thread> // WHY: For processing multiple images concurrently.
+#include <thread>
 #include <vector>
 
+#include "arena.hh"        // WHY: For the arena high-water marks --stats reports.
+#include "chroma_index.hh" // WHY: Keeps per-image chroma histograms across runs with --index.
+#include "kernel.hh"
 #include "lut.hh"
+#include "lut_file.hh" // WHY: Maps --lut-file tables and writes them with --dump-lut.
 #include "process.hh"
+#include "read_ahead.hh" // WHY: Reads files ahead of the workers with --read-ahead.
+#include "result_cache.hh" // WHY: Answers unchanged files from earlier runs with --cache.
+#include "worker_pool.hh" // WHY: Bounded pool of threads for processing multiple images concurrently.
+
+// Most input files a run takes lazily filled LUTs for (see get_lazy_chroma_lut()).
+// WHY a limit? A lazy table spares the ~3 ms of generating a whole one, but its test for unfilled
+// entries costs the kernels 5-10% for the rest of the run; past a dozen or so pages that is more.
+// WHY count files, not pixels? The test's cost grows with pixels, but so does decoding, which
+// takes 2-3 times as long as the kernels (a 6.6 MP JPEG page: 16 ms against 6 ms). It is thus
+// about 2% of any file's time, and the files are the unit the saving is spread over. A few huge
+// images under the limit lose no more than those 2%, and counting needs no stat or header read
+// before the first file is read.
+constexpr std::size_t lazy_lut_max_files{16};
+
+// Parses --thresholds: comma-separated values and inclusive "first:last[:step]" ranges, e.g.
+// "3,5,8" or "2:20:2". Returns std::nullopt when an item is malformed or not positive.
+static std::optional<std::vector<float>> parse_threshold_list(const std::string &text)
+{
+    std::vector<float> thresholds;
+    std::stringstream items{text};
+    for (std::string item; std::getline(items, item, ',');) {
+        std::vector<float> fields;
+        std::stringstream parts{item};
+        for (std::string part; std::getline(parts, part, ':');) {
+            std::size_t parsed{0};
+            try {
+                fields.push_back(std::stof(part, &parsed));
+            } catch (const std::exception &) {
+                return std::nullopt;
+            }
+            // WHY check parsed? std::stof accepts "5x" and ignores the rest.
+            if (parsed != part.size() || !(fields.back() > 0.f))
+                return std::nullopt;
+        }
+        if (fields.size() == 1) {
+            thresholds.push_back(fields[0]);
+        } else if (fields.size() == 2 || fields.size() == 3) {
+            const float step{fields.size() == 3 ? fields[2] : 1.f};
+            if (fields[1] < fields[0])
+                return std::nullopt;
+            // WHY count steps instead of adding up? Repeated float additions drift off the grid.
+            const int steps{static_cast<int>(std::floor((fields[1] - fields[0]) / step + 1e-4f))};
+            for (int i = 0; i <= steps; ++i)
+                thresholds.push_back(fields[0] + static_cast<float>(i) * step);
+        } else {
+            return std::nullopt;
+        }
+    }
+    if (thresholds.empty())
+        return std::nullopt;
+    return thresholds;
+}
 
 int main(int argc, char **argv)
 {
@@ -21,59 +80,148 @@ int main(int argc, char **argv)
 
     std::vector<std::string> image_filenames;
     // WHY float? Chroma threshold can be non-integer. Default 5 is common for distinguishing gray.
+    std::string threshold_list; // WHY string? --thresholds mixes values and ranges ("3,5,8" or "2:20:2").
     float chroma_threshold{5.f};
-    bool use_sepia_preset{false};  // WHY bool? Simple flag for a specific preset.
-    bool file_names_only{false};   // WHY bool? Flag to change output column order.
-    bool output_max_chroma{false}; // WHY bool? Flag to output max chroma instead of ratio.
-    int dump_lut_at_threshold{0};  // WHY int? Threshold for dumping is integer; 0 means disabled.
+    bool use_sepia_preset{false};     // WHY bool? Simple flag for a specific preset.
+    bool file_names_only{false};      // WHY bool? Flag to change output column order.
+    bool output_max_chroma{false};    // WHY bool? Flag to output max chroma instead of ratio.
+    bool exact_classification{false}; // WHY bool? Flag to classify with the exact 2 MiB bitset.
+    int dump_lut_at_threshold{0};     // WHY int? Threshold for dumping is integer; 0 means disabled.
+    std::string lut_file_path;        // WHY string? Path of the --lut-file table; empty means none.
+    int lut_size{RG_LUT_BLOCKS};      // WHY int? Blocks per side of the block LUT: 64, 128 or 256.
     std::optional<float> greater_than{std::nullopt};
     std::optional<float> less_than{std::nullopt};
+    float sample_amount{0.f}; // WHY float? A fraction below 1, or a pixel count; 0 means every pixel.
+    std::string jpeg_scale{"1/1"}; // WHY string? Accepts the same "1/N" form the help text shows.
+    // WHY size_t? MiB of RGB per streamed band; larger JPEG/WebP images are decoded band by band, 0 never streams.
+    std::size_t band_size_mib{16};
+    // WHY float? Megapixels from which one image is classified by several workers; 0 never splits.
+    float split_megapixels{4.f};
     bool sort_results{false};
+    bool unordered_output{false}; // WHY bool? Flag to print results in completion order.
+    // WHY size_t? Number of worker threads; 0 means one per hardware thread.
+    std::size_t worker_count{0};
+    // WHY size_t? Number of file reads kept in flight ahead of the workers; 0 means workers read their own files.
+    std::size_t read_ahead_depth{0};
+    std::string kernel_name{"auto"}; // WHY string? "auto" or a kernel name accepted by parse_kernel_isa().
+    std::string index_path; // WHY string? Path of the --index file; empty means no index.
+    std::string cache_path; // WHY string? Path of the --cache file; empty means no cache.
+    bool print_version{false};
+    bool print_stats{false}; // WHY bool? Flag to report pixel counters on stderr.
 
     // --- Positional Arguments ---
     app_parser.add_option("files", image_filenames, "Image files to process (required unless using --dump-lut)");
 
     // --- Options ---
     // Renamed from -c,--chroma for clarity, as it's the threshold value.
-    app_parser.add_option("-t,--threshold", chroma_threshold, "Chroma threshold for color detection (default: 5.0)")
-        ->check(CLI::PositiveNumber); // WHY check? Ensure threshold is physically meaningful.
+    auto *threshold_option =
+        app_parser.add_option("-t,--threshold", chroma_threshold, "Chroma threshold for color detection (default: 5.0)")
+            ->check(CLI::PositiveNumber); // WHY check? Ensure threshold is physically meaningful.
+
+    // WHY exclude the filters? -g/-l, --sample and -m each decide on one value per image.
+    auto *thresholds_option =
+        app_parser
+            .add_option("--thresholds", threshold_list,
+                        "Print the color ratio for each of these thresholds from one decode and one pass, e.g. 3,5,8,13 "
+                        "or 2:20:2 (first:last:step)")
+            ->excludes(threshold_option);
 
     app_parser
         .add_option("-g,--greater-than", greater_than,
                     "List images with color ratio greater than this value (default: none)")
-        ->check(CLI::PositiveNumber); // WHY check? Ensure threshold is physically meaningful.
+        ->check(CLI::PositiveNumber) // WHY check? Ensure threshold is physically meaningful.
+        ->excludes(thresholds_option);
     app_parser.add_option("-l,--less-than", less_than, "List images with color ratio less than this value (default: none)")
-        ->check(CLI::PositiveNumber); // WHY check? Ensure threshold is physically meaningful.
+        ->check(CLI::PositiveNumber) // WHY check? Ensure threshold is physically meaningful.
+        ->excludes(thresholds_option);
+
+    auto *sample_option =
+        app_parser
+            .add_option("--sample", sample_amount,
+                        "Estimate the color ratio from a stratified random subset: a fraction of the pixels (< 1) or a "
+                        "pixel count per image (>= 1); prints a 95% confidence interval")
+            ->check(CLI::PositiveNumber)
+            ->excludes(thresholds_option);
+
+    auto *scale_option =
+        app_parser
+            .add_option("--scale", jpeg_scale, "Decode JPEGs at reduced size: 1/1, 1/2, 1/4 or 1/8 (default: 1/1)")
+            ->check(CLI::IsMember({"1/1", "1/2", "1/4", "1/8"}));
+
+    // WHY exclude --scale? A summary describes the full-size pixels; a reduced decode has others.
+    app_parser
+        .add_option("--index", index_path,
+                    "Keep a chroma histogram per image in this file and answer -x and -m queries from it on later "
+                    "runs without decoding (created if missing); needs -x or -m. Answers are exact, also with --sample")
+        ->excludes(scale_option);
+
+    app_parser.add_option("--cache", cache_path,
+                          "Keep every result in this file and reuse it on later runs with the same settings while the "
+                          "file's size and mtime are unchanged (created if missing)");
+
+    app_parser
+        .add_option("--band-size", band_size_mib,
+                    "Decode JPEG and WebP images larger than this many MiB of RGB in bands of that size, bounding "
+                    "memory per worker (default: 16, 0 = always decode whole)")
+        ->check(CLI::NonNegativeNumber);
+
+    app_parser
+        .add_option("--split", split_megapixels,
+                    "Classify images of at least this many megapixels on several workers at once (default: 4, 0 = never)")
+        ->check(CLI::NonNegativeNumber);
+
+    app_parser.add_option("-j,--jobs", worker_count, "Number of worker threads (default: number of hardware threads)")
+        ->check(CLI::PositiveNumber); // WHY check? A pool needs at least one worker.
+
+    app_parser
+        .add_option("--read-ahead", read_ahead_depth,
+                    "Keep this many file reads in flight ahead of the workers, for slow or network storage "
+                    "(default: 0 = each worker reads its own file)")
+        ->check(CLI::NonNegativeNumber);
+
+    app_parser
+        .add_option("--kernel", kernel_name, "Pixel kernel: auto, scalar, sse4.2, avx2 or avx512 (default: auto = best for CPU)")
+        ->check(CLI::IsMember({"auto", "scalar", "sse4.2", "avx2", "avx512"}));
 
     // Renamed from -t,--lookup-table to avoid conflict with --threshold and be more descriptive.
     app_parser.add_option("-d,--dump-lut", dump_lut_at_threshold, "Dump precomputed LUT for a threshold and exit (default: 0)");
 
+    app_parser.add_option("--lut-file", lut_file_path,
+                          "Map the block LUT from this file instead of building it, and use its threshold unless -t or -s "
+                          "is given; with --dump-lut, write the table to this file instead of printing it as C++");
+
+    app_parser
+        .add_option("--lut-blocks", lut_size,
+                    "Blocks per side of the block LUT: 64 (8 KiB), 128 (32 KiB) or 256 (128 KiB); finer tables count "
+                    "fewer colored pixels as gray but take more cache (default: 64, or the --lut-file's size)")
+        ->check(CLI::IsMember({64, 128, 256}));
+
     // --- Flags ---
-    app_parser.add_flag("-s,--sepia", use_sepia_preset, "Use preset threshold=13 for sepia detection (overrides -t)");
+    app_parser.add_flag("-s,--sepia", use_sepia_preset, "Use preset threshold=13 for sepia detection (overrides -t)")
+        ->excludes(thresholds_option);
 
     app_parser.add_flag("-f,--file-names-only", file_names_only, "Output only file names");
 
-    app_parser.add_flag("-m,--max-chroma", output_max_chroma, "Output max chroma value instead of color ratio");
+    app_parser.add_flag("-m,--max-chroma", output_max_chroma, "Output max chroma value instead of color ratio")
+        ->excludes(sample_option) // WHY excludes? A maximum cannot be estimated from a sample.
+        ->excludes(thresholds_option);
+
+    app_parser.add_flag("-x,--exact", exact_classification,
+                        "Classify each RGB value by its own chroma (2 MiB table) instead of the block LUT");
+
+    auto *sort_flag = app_parser.add_flag("-r,--reverse-sort", sort_results, "Sort results by value descending (stable sort)");
 
-    app_parser.add_flag("-r,--reverse-sort", sort_results, "Sort results by value descending (stable sort)");
+    app_parser
+        .add_flag("-u,--unordered", unordered_output, "Print each result as soon as its file finishes, not in input order")
+        ->excludes(sort_flag); // WHY excludes? Sorting needs every result before printing anything.
+
+    app_parser.add_flag("--stats", print_stats,
+                        "Print scanned/skipped pixel counts and buffer arena sizes to stderr after processing");
 
     // --- Standard Flags ---
-    // WHY add_flag_function? Provides a way to execute code (print version, exit) when flag is detected.
-    // The callback takes the count of the flag occurrences.
-    app_parser.add_flag_function(
-        "-v,--version",          // Flag names
-        [&](std::size_t count) { // Lambda callback function
-            // WHY check count? Ensure the callback action only happens if the flag was actually passed.
-            if (count > 0) {
-                // Print app name (if set) and version string.
-                std::cout << (app_parser.get_name().empty() ? "App" : app_parser.get_name()) << " version " << APP_VERSION
-                          << std::endl;
-                // WHY exit(0)? Standard practice to exit cleanly after printing version info.
-                exit(0);
-            }
-        },
-        "Print version information and exit" // Help description
-    );
+    // WHY a plain flag instead of a callback? The version output reports the selected kernel,
+    // which is only known after --kernel has been parsed.
+    app_parser.add_flag("-v,--version", print_version, "Print version information and exit");
 
     // --- Parse Arguments ---
     try {
@@ -92,6 +240,24 @@ int main(int argc, char **argv)
 
     // --- Post-Parsing Logic ---
 
+    // WHY select the kernel before anything else? --version reports it, and workers read it.
+    if (kernel_name != "auto") {
+        const kernel_isa requested_isa{*parse_kernel_isa(kernel_name)}; // IsMember above guarantees a known name.
+        if (!cpu_supports_kernel_isa(requested_isa)) {
+            std::cerr << "ERROR: This CPU does not support the " << kernel_name << " kernel." << std::endl;
+            return 1;
+        }
+        select_kernel_isa(requested_isa);
+    }
+
+    if (print_version) {
+        // Print app name (if set) and version string, then the pixel kernel this run would use.
+        std::cout << (app_parser.get_name().empty() ? "App" : app_parser.get_name()) << " version " << APP_VERSION << std::endl;
+        std::cout << "kernel: " << kernel_isa_name(selected_kernel_isa()) << std::endl;
+        // WHY return 0? Standard practice to exit cleanly after printing version info.
+        return 0;
+    }
+
     bool dump_mode = app_parser.count("--dump-lut") > 0;
 
     // Handle default value for --dump-lut if flag present but value omitted
@@ -110,7 +276,11 @@ int main(int argc, char **argv)
             std::cerr << "ERROR: Invalid threshold specified for --dump-lut: " << dump_lut_at_threshold << std::endl;
             return 1; // Exit with error
         }
-        dump_lookup_table(dump_lut_at_threshold);
+        if (!lut_file_path.empty()) {
+            const float threshold{static_cast<float>(dump_lut_at_threshold)};
+            return write_chroma_lut_file(lut_file_path, threshold, get_chroma_lut(lut_size, threshold)) ? 0 : 1;
+        }
+        dump_lookup_table(dump_lut_at_threshold, lut_size);
         return 0; // Exit successfully after dumping LUT
     }
 
@@ -122,54 +292,184 @@ int main(int argc, char **argv)
         return 1;                                    // Exit with error
     }
 
+    // WHY refuse instead of ignoring? The block LUT does not classify by chroma alone, so a
+    // histogram cannot answer its queries: every image would be decoded on every run while the
+    // index looked like it was working.
+    if (!index_path.empty() && !exact_classification && !output_max_chroma) {
+        std::cerr << "ERROR: --index only answers -x and -m queries; add one of them." << std::endl;
+        return 1;
+    }
+
     // Override threshold for sepia preset (only if not dumping)
     if (use_sepia_preset) {
         chroma_threshold = 13.f;
     }
 
-    // --- Proceed with Image Processing (only if not in dump mode) ---
+    // WHY declared here? Workers read the mapped table until the pool is gone.
+    chroma_lut_file lut_file;
+    if (!lut_file_path.empty()) {
+        if (!lut_file.open(lut_file_path))
+            return 1;
+        if ((app_parser.count("--threshold") > 0 || use_sepia_preset) && chroma_threshold != lut_file.chroma_threshold()) {
+            std::cerr << "ERROR: " << lut_file_path << " holds the LUT for threshold " << lut_file.chroma_threshold() << ", not "
+                      << chroma_threshold << "." << std::endl;
+            return 1;
+        }
+        // WHY the same rule for the size? A file stands for one table; only an explicit other choice is a conflict.
+        if (app_parser.count("--lut-blocks") > 0 && lut_size != lut_blocks(lut_file.lut())) {
+            const int file_lut_size{lut_blocks(lut_file.lut())};
+            std::cerr << "ERROR: " << lut_file_path << " holds a " << file_lut_size << "x" << file_lut_size << " LUT, not "
+                      << lut_size << "x" << lut_size << "." << std::endl;
+            return 1;
+        }
+        chroma_threshold = lut_file.chroma_threshold();
+        lut_size = lut_blocks(lut_file.lut());
+        // WHY provide it to lut.cc? The YUV and exact tables look the LUT up by threshold too.
+        provide_chroma_lut(chroma_threshold, lut_file.lut());
+    }
 
-    // WHY get LUT here? Precompute or retrieve the LUT once before starting threads.
-    const auto &chroma_check_lut = get_chroma_lut(chroma_threshold);
+    // --- Proceed with Image Processing (only if not in dump mode) ---
 
+    processing_options options;
+    options.file_names_only = file_names_only;
+    options.report_max_chroma = output_max_chroma;
+    options.greater_than = greater_than;
+    options.less_than = less_than;
     // WHY check size? Only print filenames if multiple files are processed, for clarity.
-    const bool print_filenames = image_filenames.size() > 1;
+    options.print_filename = image_filenames.size() > 1;
+    // WHY? With -f and no sorting the ratio is never shown, so -g/-l may stop at the first proof of a match.
+    options.value_needed = !file_names_only || sort_results;
+    options.sample_amount = sample_amount;
+    // WHY parse after "1/"? IsMember above guarantees one of 1/1, 1/2, 1/4 and 1/8.
+    options.decode.jpeg_scale_denom = std::stoi(jpeg_scale.substr(2));
+    options.decode.band_bytes = band_size_mib << 20;
 
-    // --- Launch Processing Threads ---
-    // WHY vector<result>? Pre-allocate space for results from each thread.
+    options.chroma_threshold = chroma_threshold;
+    // WHY only for several files and not with -m? A YUV table takes ~0.1 s to build, more than
+    // converting one image to RGB, but is reused by every AVIF/WebP with the same conversion.
+    // -m needs RGB values.
+    options.classify_yuv = image_filenames.size() > 1 && !output_max_chroma;
+    // WHY lazy tables for small batches? A threshold without a preset then only pays for the blocks
+    // its images reach instead of the whole table (see lazy_lut_max_files).
+    const bool lazy_luts{image_filenames.size() <= lazy_lut_max_files};
+    const auto chroma_lut_for = [&](const float threshold) {
+        return lazy_luts ? get_lazy_chroma_lut(lut_size, threshold) : get_chroma_lut(lut_size, threshold);
+    };
+    if (threshold_list.empty()) {
+        // WHY get LUT here? Precompute or retrieve the LUT once before starting threads.
+        // WHY not with --thresholds? A sweep classifies with its own tables only, so the -t table
+        // (a 2 MiB bitset with -x) would be built for nothing.
+        options.chroma_check_lut = chroma_lut_for(chroma_threshold);
+        // WHY skip with -m? Max chroma mode computes chroma directly and never consults a table.
+        if (exact_classification && !output_max_chroma) {
+            options.exact_chroma_bits = &get_chroma_bitset(chroma_threshold);
+        }
+    } else {
+        const std::optional<std::vector<float>> thresholds{parse_threshold_list(threshold_list)};
+        if (!thresholds) {
+            std::cerr << "ERROR: Invalid --thresholds list: " << threshold_list << std::endl;
+            return 1;
+        }
+        // WHY build every table here? Workers only read them; with -x each threshold costs a 2 MiB bitset.
+        for (const float threshold : *thresholds) {
+            options.sweep_tables.push_back(exact_classification
+                                               ? sweep_table{.threshold = threshold, .exact_bits = &get_chroma_bitset(threshold)}
+                                               : sweep_table{.threshold = threshold, .lut = chroma_lut_for(threshold)});
+        }
+        // WHY RGB only? A YUV table per threshold and matrix would cost more to build than converting to RGB.
+        options.classify_yuv = false;
+    }
+
+    // WHY declared before the pool? Workers read and append to it until the pool is gone.
+    chroma_index index;
+    if (!index_path.empty()) {
+        if (!index.open(index_path))
+            return 1;
+        options.index = &index;
+        // WHY RGB only? Histograms are taken over decoded RGB, the pixels -m and -x classify.
+        options.classify_yuv = false;
+    }
+    result_cache cache;
+    if (!cache_path.empty()) {
+        if (!cache.open(cache_path))
+            return 1;
+        options.cache = &cache;
+    }
+
+    // --- Queue Processing Tasks ---
+    // WHY vector<result>? Pre-allocate one result slot per file; workers fill them in place.
     std::vector<processing_result> results(image_filenames.size());
-    std::vector<std::thread> processing_threads;
-    // WHY reserve? Minor optimization to avoid potential reallocations if vector grows.
-    processing_threads.reserve(image_filenames.size());
+    // WHY channel? In --unordered mode workers report finished slots here so the printer never scans.
+    completion_channel finished_results;
+    // WHY declared before the pool? Queued tasks call reader->release(), so it must outlive the pool.
+    std::optional<read_ahead> reader;
+    // The reader's look_up_stored_result() of each file, handed to the worker that processes it.
+    std::vector<stored_result> stored_results;
+    // WHY min with file count? Never start more workers than there are files to process, unless
+    // they can help classify one large image.
+    const std::size_t pool_size{worker_count ? worker_count : worker_pool::default_worker_count()};
+    worker_pool pool{split_megapixels > 0.f ? pool_size : std::min(pool_size, image_filenames.size())};
+    options.split_pixels = static_cast<std::size_t>(static_cast<double>(split_megapixels) * 1e6);
+    options.pool = &pool;
+    // WHY declared after the pool? It submits to the pool, so it is joined before the pool goes away.
+    std::jthread reader_thread;
 
-    for (size_t i = 0; i < image_filenames.size(); ++i) {
-        // WHY emplace_back? Efficiently constructs thread in place.
-        // WHY std::ref(results[i])? Pass result slot by reference to allow modification by thread.
-        // WHY pass LUT by const ref? Avoid copying the large LUT for each thread.
-        processing_threads.emplace_back(process_image_file, image_filenames[i], file_names_only, output_max_chroma, greater_than,
-                                        less_than, print_filenames, std::ref(results[i]), std::cref(chroma_check_lut));
+    if (read_ahead_depth == 0) {
+        for (size_t i = 0; i < image_filenames.size(); ++i) {
+            // WHY capture by reference? `results`, the filenames and the options outlive the pool's work
+            // (pool.wait() or the pool destructor runs before they go out of scope).
+            pool.submit([&, i] {
+                process_image_file(image_filenames[i], options, results[i]);
+                if (unordered_output)
+                    finished_results.push(i);
+            });
+        }
+    } else {
+        stored_results.resize(image_filenames.size());
+        // WHY depth + workers buffers? Every worker can hold a file while `depth` more are read.
+        reader.emplace(image_filenames, read_ahead_depth, read_ahead_depth + pool.size());
+        // WHY a thread? The main thread must be free to print results while files are still read.
+        reader_thread = std::jthread{[&] {
+            reader->run(
+                [&](const size_t i, prefetched_file file) {
+                    pool.submit([&, i, file = std::move(file)]() mutable {
+                        process_image_file(image_filenames[i], options, results[i], file.bytes(), std::move(stored_results[i]));
+                        file = {}; // WHY free before release()? The permit stands for this buffer.
+                        reader->release();
+                        if (unordered_output)
+                            finished_results.push(i);
+                    });
+                },
+                // WHY skip stored files? They are answered from --cache or --index without decoding;
+                // reading them ahead would be the only I/O left in a rerun over unchanged files.
+                // WHY look up in the reader? The stats run on the reader threads alongside the reads,
+                // once per file, and the worker reuses the result.
+                [&](const size_t i) {
+                    stored_results[i] = look_up_stored_result(image_filenames[i], options);
+                    return !stored_results[i].counts;
+                });
+        }};
     }
     // --- Collect and Print Results ---
-    if (!sort_results) {
-        // Print results as they become available
+    if (unordered_output) {
+        // Print each result the moment its file finishes.
+        for (size_t printed = 0; printed < results.size(); ++printed) {
+            std::cout << results[finished_results.pop()].output;
+        }
+    } else if (!sort_results) {
+        // Print results in input order as they become available.
+        // WHY atomic wait? Sleeps on the slot's ready flag (futex on Linux) until the next
+        // in-order result lands, instead of burning a core with yield().
         for (size_t i = 0; i < results.size(); ++i) {
-            while (!results[i].is_ready.load(std::memory_order_acquire)) {
-                std::this_thread::yield();
-            }
+            results[i].is_ready.wait(false, std::memory_order_acquire);
             std::cout << results[i].output;
         }
-
-        // Join threads after results are printed
-        for (auto &t : processing_threads) {
-            if (t.joinable())
-                t.join();
-        }
     } else {
-        // Join all threads first to ensure all results are ready
-        for (auto &t : processing_threads) {
-            if (t.joinable())
-                t.join();
-        }
+        // Wait for every task first to ensure all results are ready
+        // WHY join the reader first? pool.wait() could otherwise return before the last file was submitted.
+        if (reader_thread.joinable())
+            reader_thread.join();
+        pool.wait();
 
         // Sort by value descending
         std::vector<std::reference_wrapper<const processing_result>> sorted_refs(results.begin(), results.end());
@@ -181,5 +481,20 @@ int main(int argc, char **argv)
         }
     }
 
+    if (print_stats) {
+        // WHY stderr? Keeps stdout a clean list of results for scripts.
+        std::size_t total_pixels{0};
+        std::size_t skipped_pixels{0};
+        for (const auto &res : results) {
+            total_pixels += res.pixel_count;
+            skipped_pixels += res.skipped_pixels;
+        }
+        std::cerr << "pixels: " << total_pixels << " decoded, " << total_pixels - skipped_pixels << " scanned, " << skipped_pixels
+                  << " skipped (-g/-l early exit, --sample, --index or --cache)" << std::endl;
+        const arena_usage arenas{buffer_arena::usage()};
+        std::cerr << "arenas: " << arenas.arena_count << " threads, largest " << (arenas.largest_bytes >> 10) << " KiB, total "
+                  << (arenas.total_bytes >> 10) << " KiB (high-water marks)" << std::endl;
+    }
+
     return 0; // Success.
 }
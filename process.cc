@@ -1,79 +1,723 @@
 #include "process.hh"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
-#include <format>  // WHY: Modern C++ way for type-safe text formatting.
+#include <atomic>
+#include <format>     // WHY: Modern C++ way for type-safe text formatting.
+#include <functional> // WHY: For std::plus, which merges per-range counts.
+#include <memory>
+#include <mutex>
+#include <random>
 #include <sstream> // WHY: Convenient for building the output string incrementally.
+#include <utility>
 
+#include "chroma_index.hh"
 #include "decode.hh"
+#include "kernel.hh"
 #include "lut.hh"
+#include "record_store.hh" // For hash_bytes, which seeds the per-file sampling RNG.
+#include "result_cache.hh"
 
-// Processes a single image file to determine color ratio or max chroma.
-void process_image_file(const std::string &filename, bool file_names_only, bool report_max_chroma,
-                        std::optional<float> greater_than, std::optional<float> less_than, bool print_filename,
-                        processing_result &result_entry, const chroma_lut_t &chroma_check_lut)
+namespace {
+
+// WHY chunks? Checking the -g/-l bounds after every pixel would slow the kernels down. One check
+// per 64K pixels (192 KiB of RGB) costs nothing measurable and still stops soon after the answer
+// is known.
+constexpr size_t early_exit_chunk_pixels{1 << 16};
+
+enum class filter_outcome { UNDECIDED, ACCEPT, REJECT };
+
+// Color ratio in percent, computed exactly as it is reported.
+// WHY one function? The early-exit bounds must agree bit for bit with the final decision.
+float color_ratio(const size_t colored_pixel_count, const size_t total_pixels)
 {
-    int image_width{0};
-    int image_height{0};
+    // WHY check total_pixels? Avoid division by zero for empty/invalid images.
+    return total_pixels ? static_cast<float>(colored_pixel_count) / total_pixels * 100.0f : 0.f;
+}
+
+bool passes_filter(const float report_value, const processing_options &options)
+{
+    return (!options.greater_than || report_value > *options.greater_than) &&
+           (!options.less_than || report_value < *options.less_than);
+}
 
-    // --- Decode Image ---
-    // WHY unique_ptr (smart_pixels_ptr)? Manages pixel buffer lifetime automatically (RAII).
-    const smart_pixels_ptr pixels{decode_image(filename, image_width, image_height)};
+// Decides -g/-l for a value known to lie in [lowest, highest].
+// WHY is testing both ends enough? The filter accepts one interval of values.
+filter_outcome range_outcome(const float lowest, const float highest, const processing_options &options)
+{
+    if ((options.greater_than && highest <= *options.greater_than) || (options.less_than && lowest >= *options.less_than))
+        return filter_outcome::REJECT;
+    if (passes_filter(lowest, options) && passes_filter(highest, options))
+        return filter_outcome::ACCEPT;
+    return filter_outcome::UNDECIDED;
+}
 
-    // Prepare output stream for results or errors.
-    std::stringstream output_stream;
+// WHY 95%? The usual triage trade-off: about one file in 20 whose true ratio sits right at the
+// cutoff gets a confident wrong answer, while the interval stays narrow for small budgets.
+constexpr double confidence_z{1.959964}; // Two-sided 95% normal quantile.
+
+// Wilson score interval of a binomial proportion, in percent.
+// WHY Wilson rather than p +- z*sigma? It stays inside [0, 100] and does not collapse to zero width
+// when the sample holds no (or only) colored pixels, which is the common case for gray pages.
+std::pair<float, float> wilson_interval(const size_t colored_samples, const size_t sample_count)
+{
+    const double n{static_cast<double>(sample_count)};
+    const double p{colored_samples / n};
+    const double z2{confidence_z * confidence_z};
+    const double center{(p + z2 / (2 * n)) / (1 + z2 / n)};
+    const double half_width{confidence_z * std::sqrt(p * (1 - p) / n + z2 / (4 * n * n)) / (1 + z2 / n)};
+    return {static_cast<float>(std::max(0.0, center - half_width) * 100),
+            static_cast<float>(std::min(1.0, center + half_width) * 100)};
+}
+
+size_t count_colored(const uint8_t *rgb_pixels, const size_t pixel_count, const processing_options &options)
+{
+    // WHY kernel call? The SIMD kernels classify many pixels per instruction and return the
+    // same count as the one-pixel-at-a-time loop (see kernel.hh).
+    // WHY two tables? The exact bitset classifies every RGB value by its own chroma; the
+    // default 64x64 LUT is 256x smaller but shares one B range per 4x4 (R,G) block.
+    return options.exact_chroma_bits ? count_colored_pixels_exact(rgb_pixels, pixel_count, *options.exact_chroma_bits)
+                                     : count_colored_pixels(rgb_pixels, pixel_count, options.chroma_check_lut);
+}
+
+// WHY 16K pixels? 48 KiB of RGB stays in cache while every --thresholds table classifies it, so
+// the pixels are read from memory once however many thresholds are swept.
+constexpr size_t sweep_chunk_pixels{1 << 14};
+
+// Adds the colored pixels for each --thresholds table to `counts` (one entry per table).
+// WHY the single-threshold kernels? They are the classifiers -t uses, so every ratio of a sweep
+// matches a separate -t run exactly; the sweep only saves the decodes and the memory traffic.
+void count_colored_sweep(const uint8_t *rgb_pixels, size_t pixel_count, const processing_options &options, size_t *counts)
+{
+    while (pixel_count) {
+        const size_t chunk_pixels{std::min(sweep_chunk_pixels, pixel_count)};
+        for (size_t i = 0; i < options.sweep_tables.size(); ++i) {
+            const sweep_table &table{options.sweep_tables[i]};
+            counts[i] += table.exact_bits ? count_colored_pixels_exact(rgb_pixels, chunk_pixels, *table.exact_bits)
+                                          : count_colored_pixels(rgb_pixels, chunk_pixels, table.lut);
+        }
+        rgb_pixels += chunk_pixels * 3;
+        pixel_count -= chunk_pixels;
+    }
+}
+
+// The decoded pixels: packed RGB, or YUV planes plus the table that classifies them.
+struct pixel_source {
+    const uint8_t *rgb_pixels{nullptr}; // 3 bytes per pixel; null when `yuv` is set.
+    const yuv_planes *yuv{nullptr};
+    const chroma_bitset_t *yuv_bits{nullptr}; // From get_yuv_chroma_bitset() for yuv->conversion.
+    size_t width{0};
+    size_t origin{0}; // Index of the pixel at rgb_pixels[0]: a band's first pixel when streaming.
+};
+
+// Counts the colored pixels among pixels [first, first + pixel_count) in row-major order.
+size_t count_colored_span(const pixel_source &source, size_t first, size_t pixel_count, const processing_options &options)
+{
+    if (!source.yuv)
+        return count_colored(source.rgb_pixels + (first - source.origin) * 3, pixel_count, options);
+
+    // WHY row by row? Each plane has its own stride, and chroma rows are shared by 4:2:0 luma rows.
+    const yuv_planes &yuv{*source.yuv};
+    size_t colored_pixel_count{0};
+    while (pixel_count) {
+        const size_t row{first / source.width};
+        const size_t x{first % source.width};
+        const size_t row_pixels{std::min(pixel_count, source.width - x)};
+        const size_t chroma_offset{(row >> yuv.chroma_shift_y) * yuv.uv_stride};
+        colored_pixel_count += count_colored_pixels_yuv(yuv.y_plane + row * yuv.y_stride, yuv.u_plane + chroma_offset,
+                                                        yuv.v_plane + chroma_offset, x, row_pixels, yuv.chroma_shift_x,
+                                                        *source.yuv_bits);
+        first += row_pixels;
+        pixel_count -= row_pixels;
+    }
+    return colored_pixel_count;
+}
+
+// Number of pixels --sample classifies in an image (all of them without --sample).
+size_t sampled_pixel_count(const size_t total_pixels, const processing_options &options)
+{
+    if (options.sample_amount <= 0.f)
+        return total_pixels;
+    const size_t wanted{options.sample_amount < 1.f
+                            ? static_cast<size_t>(std::ceil(static_cast<double>(options.sample_amount) * total_pixels))
+                            : static_cast<size_t>(options.sample_amount)};
+    return std::min(wanted, total_pixels);
+}
+
+// WHY 256K pixels per range? Small enough that 4 MP gives every worker of a large machine a few
+// ranges to balance, large enough that claiming one (an atomic add and a lock) is noise.
+constexpr size_t split_range_pixels{1 << 18};
+
+// One span of an image being classified by several workers (see image_scan::split_scan()).
+// WHY shared? Helper tasks may start after the owner has finished the span and returned; they
+// only touch this struct then, never the pixels.
+struct split_job {
+    const processing_options *options{nullptr};
+    const pixel_source *source{nullptr}; // Only read while a claimed range is being scanned.
+    size_t first{0};
+    size_t end{0};
+    size_t range_count{0};
+    size_t total_pixels{0};
+    size_t base_colored_pixels{0}; // Counts of the spans scanned before this one, for the -g/-l bounds.
+    size_t base_scanned_pixels{0};
+
+    std::atomic<size_t> next_range{0};
+    std::atomic<size_t> finished_ranges{0};
+    std::atomic<bool> settled{false}; // -g/-l decided; remaining ranges are skipped.
+    std::vector<float> range_max_chroma; // -m: one maximum per range.
 
-    // WHY check pixels? Decoding can fail; handle gracefully.
-    if (!pixels) {
-        output_stream << "ERROR decoding " << filename << "\n";
-        result_entry.output = output_stream.str();
-        // WHY atomic store? Signal main thread that this result is ready (with error).
-        // std::memory_order_release ensures preceding writes (like output string) are visible
-        // to the acquiring thread.
-        result_entry.is_ready.store(true, std::memory_order_release);
+    // WHY a mutex? The -g/-l bounds need the colored and scanned counts as one consistent pair.
+    std::mutex mutex;
+    size_t colored_pixel_count{0};
+    size_t scanned_pixels{0};
+    std::vector<size_t> sweep_counts; // --thresholds: colored pixels per table.
+
+    bool summarize{false}; // --index: also histogram every range, settled or not.
+    std::array<uint32_t, CHROMA_HISTOGRAM_BINS> summary_bins{};
+    float summary_max_chroma_squared{0.f};
+};
+
+void scan_split_range(split_job &job, const size_t range)
+{
+    const processing_options &options{*job.options};
+    const size_t first{job.first + range * split_range_pixels};
+    const size_t pixel_count{std::min(split_range_pixels, job.end - first)};
+    if (job.summarize) {
+        const uint8_t *const rgb_pixels{job.source->rgb_pixels + (first - job.source->origin) * 3};
+        std::array<uint32_t, CHROMA_HISTOGRAM_BINS> bins{};
+        count_chroma_bins(rgb_pixels, pixel_count, bins);
+        const float range_max_chroma_squared{::max_chroma_squared(rgb_pixels, pixel_count)};
+        std::lock_guard lock{job.mutex};
+        std::ranges::transform(job.summary_bins, bins, job.summary_bins.begin(), std::plus{});
+        job.summary_max_chroma_squared = std::max(job.summary_max_chroma_squared, range_max_chroma_squared);
+    }
+    if (job.settled.load(std::memory_order_relaxed))
+        return;
+
+    if (options.report_max_chroma) {
+        job.range_max_chroma[range] =
+            ::max_chroma_squared(job.source->rgb_pixels + (first - job.source->origin) * 3, pixel_count);
+        return;
+    }
+    if (!options.sweep_tables.empty()) {
+        std::vector<size_t> sweep_counts(options.sweep_tables.size());
+        count_colored_sweep(job.source->rgb_pixels + (first - job.source->origin) * 3, pixel_count, options, sweep_counts.data());
+        std::lock_guard lock{job.mutex};
+        std::ranges::transform(job.sweep_counts, sweep_counts, job.sweep_counts.begin(), std::plus{});
+        job.scanned_pixels += pixel_count;
         return;
     }
 
-    // --- Analyze Pixels ---
-    const size_t total_pixels{static_cast<size_t>(image_width) * image_height};
+    const size_t colored_pixel_count{count_colored_span(*job.source, first, pixel_count, options)};
+    std::lock_guard lock{job.mutex};
+    job.colored_pixel_count += colored_pixel_count;
+    job.scanned_pixels += pixel_count;
+    if ((!options.greater_than && !options.less_than) || options.cache)
+        return;
+    // The final count lies in [colored, colored + unscanned], whichever ranges are still out.
+    const size_t colored{job.base_colored_pixels + job.colored_pixel_count};
+    const size_t unscanned{job.total_pixels - job.base_scanned_pixels - job.scanned_pixels};
+    const filter_outcome outcome{range_outcome(color_ratio(colored, job.total_pixels),
+                                               color_ratio(colored + unscanned, job.total_pixels), options)};
+    if (outcome == filter_outcome::REJECT || (outcome == filter_outcome::ACCEPT && !options.value_needed))
+        job.settled.store(true, std::memory_order_relaxed);
+}
+
+// Claims and scans ranges until none are left. Run by the owner and by every helper task.
+void run_split_ranges(split_job &job)
+{
+    while (true) {
+        const size_t range{job.next_range.fetch_add(1, std::memory_order_relaxed)};
+        if (range >= job.range_count)
+            return;
+        // WHY claim ranges after -g/-l is settled? The owner waits until every range is finished,
+        // and --index still needs their histograms.
+        scan_split_range(job, range);
+        if (job.finished_ranges.fetch_add(1, std::memory_order_acq_rel) + 1 == job.range_count)
+            job.finished_ranges.notify_all();
+    }
+}
+
+// WHY copy samples into a batch? The picked pixels go through the same SIMD kernels and tables as a full scan.
+constexpr size_t sample_batch_pixels{4096};
+
+// Classifies one image's pixels as they arrive in row-major order: all at once after a whole
+// decode, or band by band while a large image streams in (see decode_image_bands()).
+class image_scan {
+  public:
+    image_scan(const std::string &filename, size_t total_pixels, const processing_options &options);
+
+    // Classifies pixels [first, first + pixel_count) of `source`; `first` continues where the
+    // previous call ended. Returns false once the remaining pixels cannot change the result
+    // (never with --index, which needs every pixel).
+    bool scan(const pixel_source &source, size_t first, size_t pixel_count);
+
+    // Classifies the samples still batched. Call once, after the last scan().
+    void finish();
+
+    const processing_options &options;
+    const size_t total_pixels;
+    const size_t sample_count; // Pixels --sample classifies; total_pixels without it.
     size_t colored_pixel_count{0};
     // WHY float? Chroma calculation involves floating point.
     // WHY squared? Avoids sqrt in the loop for performance; compare threshold squared later.
     float max_chroma_squared{0.f};
+    size_t scanned_pixels{0}; // Pixels classified before the result was settled.
+    bool settled{false};      // -g/-l decided or --sample complete; later pixels are only summarized.
+    std::vector<size_t> sweep_counts; // --thresholds: colored pixels per table.
+
+    // --index: chroma histogram of the RGB pixels scanned so far. The image can be recorded once
+    // summarized_pixels reaches total_pixels.
+    bool summarizing{false};
+    chroma_summary summary;
+    size_t summarized_pixels{0};
+
+  private:
+    bool classify(const pixel_source &source, size_t first, size_t pixel_count);
+    bool split_scan(const pixel_source &source, size_t first, size_t pixel_count);
+    void pick_sample();
+    void flush_samples();
+
+    // --sample state.
+    // WHY stratified (jittered)? The pixels are cut into sample_count equal runs in row-major order
+    // and one random pixel is taken from each run, so every row band is covered in proportion to its
+    // size. That never does worse than plain random sampling and avoids the aliasing a fixed stride
+    // would have with halftone patterns or column layouts.
+    std::minstd_rand rng;
+    size_t next_run{0};    // Run the next sample is taken from.
+    size_t next_sample{0}; // Pixel picked from that run.
+    // YUV pixels are stored as Y, U, V bytes, which is the bit index layout of the YUV table.
+    std::array<uint8_t, sample_batch_pixels * 3> batch;
+    size_t batch_pixels{0};
+    const chroma_bitset_t *batch_yuv_bits{nullptr}; // Set when the batch holds YUV samples.
+};
+
+image_scan::image_scan(const std::string &filename, const size_t total_pixels, const processing_options &options)
+    : options{options}, total_pixels{total_pixels},
+      // WHY not with -m? The maximum needs every pixel.
+      sample_count{options.report_max_chroma ? total_pixels : sampled_pixel_count(total_pixels, options)},
+      sweep_counts(options.sweep_tables.size()),
+      // WHY seed from the file name? Repeated runs report the same estimate for the same file.
+      // WHY FNV-1a rather than std::hash? std::hash may differ between builds and standard libraries,
+      // and --cache keeps sampled results across runs.
+      rng{static_cast<std::minstd_rand::result_type>(
+          hash_bytes({reinterpret_cast<const uint8_t *>(filename.data()), filename.size()}))}
+{
+    if (sample_count < total_pixels)
+        pick_sample();
+    // WHY the limit? Histogram bins are 32-bit.
+    summarizing = options.index && total_pixels <= UINT32_MAX;
+}
+
+void image_scan::pick_sample()
+{
+    // Run k covers pixels [k * total / count, (k + 1) * total / count).
+    // WHY no overflow? Both factors are at most the pixel count, far below 2^32.
+    const size_t run_begin{next_run * total_pixels / sample_count};
+    const size_t run_end{(next_run + 1) * total_pixels / sample_count};
+    next_sample = run_begin + std::uniform_int_distribution<size_t>{0, run_end - run_begin - 1}(rng);
+}
+
+void image_scan::flush_samples()
+{
+    colored_pixel_count += batch_yuv_bits ? count_colored_pixels_exact(batch.data(), batch_pixels, *batch_yuv_bits)
+                                          : count_colored(batch.data(), batch_pixels, options);
+    batch_pixels = 0;
+}
+
+bool image_scan::scan(const pixel_source &source, const size_t first, const size_t pixel_count)
+{
+    // WHY RGB only? The histogram bins RGB values; --index turns YUV classification off.
+    if (source.yuv)
+        summarizing = false;
+
+    // WHY not --sample? It classifies a few thousand pixels, far less than the cost of a split.
+    if (sample_count == total_pixels && options.pool && options.pool->size() > 1 && options.split_pixels &&
+        total_pixels >= options.split_pixels && pixel_count >= 2 * split_range_pixels)
+        return split_scan(source, first, pixel_count);
+
+    if (summarizing) {
+        const uint8_t *const rgb_pixels{source.rgb_pixels + (first - source.origin) * 3};
+        count_chroma_bins(rgb_pixels, pixel_count, summary.bins);
+        summary.max_chroma_squared = std::max(summary.max_chroma_squared, ::max_chroma_squared(rgb_pixels, pixel_count));
+        summarized_pixels += pixel_count;
+    }
+    if (!settled)
+        settled = !classify(source, first, pixel_count);
+    // WHY go on once settled? --index records the image only from a histogram of every pixel.
+    return !settled || summarizing;
+}
+
+bool image_scan::classify(const pixel_source &source, size_t first, const size_t pixel_count)
+{
+    const size_t end{first + pixel_count};
+
+    if (!options.sweep_tables.empty()) {
+        // --- Threshold Sweep ---
+        count_colored_sweep(source.rgb_pixels + (first - source.origin) * 3, pixel_count, options, sweep_counts.data());
+        scanned_pixels = end;
+        return true;
+    }
+
+    if (options.report_max_chroma) {
+        // --- Max Chroma Tracking ---
+        // WHY compute chroma separately? Only needed if max chroma output is requested;
+        // the colored pixel count is not reported in this mode, so it is skipped.
+        max_chroma_squared =
+            std::max(max_chroma_squared, ::max_chroma_squared(source.rgb_pixels + (first - source.origin) * 3, pixel_count));
+        scanned_pixels = end;
+        return true;
+    }
 
-    for (size_t i = 0; i < total_pixels; ++i) {
-        // Assuming RGB layout: R=pix[3*i], G=pix[3*i+1], B=pix[3*i+2]
-        const uint8_t r{pixels[3 * i + 0]};
-        const uint8_t g{pixels[3 * i + 1]};
-        const uint8_t b{pixels[3 * i + 2]};
+    if (sample_count < total_pixels) {
+        // --- Sampled Chroma Check ---
+        // WHY? Classifying a fixed budget costs the same for every resolution; the interval says
+        // how far the estimate can be trusted.
+        batch_yuv_bits = source.yuv ? source.yuv_bits : nullptr;
+        while (next_run < sample_count && next_sample < end) {
+            uint8_t *sample{batch.data() + batch_pixels * 3};
+            if (source.yuv) {
+                const yuv_planes &yuv{*source.yuv};
+                const size_t row{next_sample / source.width};
+                const size_t x{next_sample % source.width};
+                const size_t chroma_index{(row >> yuv.chroma_shift_y) * yuv.uv_stride + (x >> yuv.chroma_shift_x)};
+                sample[0] = yuv.y_plane[row * yuv.y_stride + x];
+                sample[1] = yuv.u_plane[chroma_index];
+                sample[2] = yuv.v_plane[chroma_index];
+            } else {
+                std::copy_n(source.rgb_pixels + (next_sample - source.origin) * 3, 3, sample);
+            }
+            if (++batch_pixels == sample_batch_pixels)
+                flush_samples();
+            if (++next_run < sample_count)
+                pick_sample();
+        }
+        scanned_pixels = end;
+        // WHY stop after the last sample? A streamed image need not decode the rows below it.
+        return next_run < sample_count;
+    }
 
+    // WHY no early exit with --cache? Only a complete count can answer later runs.
+    if ((!options.greater_than && !options.less_than) || options.cache) {
         // --- Chroma Check using LUT ---
-        // WHY bit shifts (>> 2)? Divides R and G by 4 to get index into 64x64 LUT.
-        // This effectively groups 4x4 blocks of R and G values.
-        const uint16_t min_max_b_packed{chroma_check_lut[r >> 2][g >> 2]};
-        // WHY bit shifts and masking? Extracts the precomputed min/max B values
-        // packed into the uint16_t for the given R,G block.
-        const uint8_t min_b_for_gray{static_cast<uint8_t>(min_max_b_packed >> 8)};   // High byte
-        const uint8_t max_b_for_gray{static_cast<uint8_t>(min_max_b_packed & 0xff)}; // Low byte
-
-        // WHY check range? If B is outside the precomputed [min, max] range for this R,G block,
-        // the pixel's chroma MUST exceed the threshold used to generate the LUT. This is the
-        // core optimization - avoids expensive chroma calculation for most pixels.
-        if (b < min_b_for_gray || b > max_b_for_gray) {
-            colored_pixel_count++;
+        colored_pixel_count += count_colored_span(source, first, pixel_count, options);
+        scanned_pixels = end;
+        return true;
+    }
+
+    // --- Chroma Check with early exit for -g/-l ---
+    // WHY stop early? Once the filter outcome cannot change, the rest of the image is wasted work.
+    // A rejected file prints nothing, so it can always stop; an accepted one only when its
+    // ratio is neither printed nor sorted on.
+    while (first < end) {
+        // WHY chunks aligned to the image? Bands then stop at the same pixel a whole decode would.
+        const size_t chunk_pixels{std::min(early_exit_chunk_pixels - first % early_exit_chunk_pixels, end - first)};
+        colored_pixel_count += count_colored_span(source, first, chunk_pixels, options);
+        first += chunk_pixels;
+        scanned_pixels = first;
+        if (first % early_exit_chunk_pixels != 0 && first != total_pixels)
+            continue;
+
+        // The final count lies in [colored, colored + remaining] and the ratio grows with it.
+        const filter_outcome outcome{
+            range_outcome(color_ratio(colored_pixel_count, total_pixels),
+                          color_ratio(colored_pixel_count + total_pixels - scanned_pixels, total_pixels), options)};
+        if (outcome == filter_outcome::REJECT || (outcome == filter_outcome::ACCEPT && !options.value_needed))
+            return false;
+    }
+    return true;
+}
+
+// Scans a span with the help of idle workers. Ranges are claimed in order from an atomic counter;
+// the owner scans them too, so the span finishes even when every other worker is busy.
+// WHY ranges of pixels, not rows? count_colored_span() handles partial rows, and fixed-size
+// ranges balance the same whatever the image width.
+bool image_scan::split_scan(const pixel_source &source, const size_t first, const size_t pixel_count)
+{
+    const auto job{std::make_shared<split_job>()};
+    job->options = &options;
+    job->source = &source;
+    job->first = first;
+    job->end = first + pixel_count;
+    job->range_count = (pixel_count + split_range_pixels - 1) / split_range_pixels;
+    job->total_pixels = total_pixels;
+    job->base_colored_pixels = colored_pixel_count;
+    job->base_scanned_pixels = scanned_pixels;
+    job->settled.store(settled, std::memory_order_relaxed);
+    job->summarize = summarizing;
+    if (options.report_max_chroma)
+        job->range_max_chroma.resize(job->range_count);
+    job->sweep_counts.resize(options.sweep_tables.size());
+
+    // WHY one helper fewer than workers? The owner is one of them.
+    const size_t helper_count{std::min(options.pool->size() - 1, job->range_count - 1)};
+    for (size_t i = 0; i < helper_count; ++i) {
+        options.pool->submit([job] { run_split_ranges(*job); });
+    }
+    run_split_ranges(*job);
+    // WHY wait? Helpers may still be scanning ranges they claimed, and the pixels must outlive them.
+    for (size_t finished; (finished = job->finished_ranges.load(std::memory_order_acquire)) < job->range_count;) {
+        job->finished_ranges.wait(finished, std::memory_order_acquire);
+    }
+
+    std::lock_guard lock{job->mutex};
+    if (summarizing) {
+        std::ranges::transform(summary.bins, job->summary_bins, summary.bins.begin(), std::plus{});
+        summary.max_chroma_squared = std::max(summary.max_chroma_squared, job->summary_max_chroma_squared);
+        summarized_pixels += pixel_count;
+    }
+    if (options.report_max_chroma) {
+        max_chroma_squared = std::max(max_chroma_squared, std::ranges::max(job->range_max_chroma));
+        scanned_pixels += pixel_count;
+        return true;
+    }
+    std::ranges::transform(sweep_counts, job->sweep_counts, sweep_counts.begin(), std::plus{});
+    colored_pixel_count += job->colored_pixel_count;
+    scanned_pixels += job->scanned_pixels;
+    settled = job->settled.load(std::memory_order_relaxed);
+    return !settled || summarizing;
+}
+
+void image_scan::finish()
+{
+    if (batch_pixels)
+        flush_samples();
+}
+
+image_counts counts_from_scan(const image_scan &scan)
+{
+    image_counts counts{.total_pixels = scan.total_pixels,
+                        .sample_count = scan.sample_count,
+                        .colored_pixel_count = scan.colored_pixel_count,
+                        .max_chroma_squared = scan.max_chroma_squared,
+                        .sweep_counts = scan.sweep_counts};
+    // WHY is a partial count safe to report? After an early exit it is itself a possible final
+    // count, so it lands on the same side of -g/-l as the true ratio.
+    counts.skipped_pixels =
+        scan.sample_count < scan.total_pixels ? scan.total_pixels - scan.sample_count : scan.total_pixels - scan.scanned_pixels;
+    return counts;
+}
+
+// Answers the run's question from a stored summary, or returns std::nullopt when it cannot:
+// the block LUT does not classify by chroma alone, so only -m and --exact queries whose
+// thresholds fall on a histogram bin edge are answered (main() refuses --index without either).
+// WHY sample_count = total_pixels under --sample? The summary covers every pixel, so the ratio
+// is exact and is printed with a zero-width interval, like an image smaller than the sample.
+std::optional<image_counts> counts_from_summary(const chroma_summary &summary, const processing_options &options)
+{
+    const size_t total_pixels{static_cast<size_t>(summary.width) * summary.height};
+    // WHY skipped = total? No pixel was scanned in this run (--stats).
+    image_counts counts{.total_pixels = total_pixels,
+                        .sample_count = total_pixels,
+                        .max_chroma_squared = summary.max_chroma_squared,
+                        .sweep_counts = {},
+                        .skipped_pixels = total_pixels};
+    if (options.report_max_chroma)
+        return counts;
+
+    if (!options.sweep_tables.empty()) {
+        for (const sweep_table &table : options.sweep_tables) {
+            const std::optional<size_t> colored{table.exact_bits ? summary_colored_pixels(summary, table.threshold) : std::nullopt};
+            if (!colored)
+                return std::nullopt;
+            counts.sweep_counts.push_back(*colored);
+        }
+        return counts;
+    }
+
+    const std::optional<size_t> colored{options.exact_chroma_bits ? summary_colored_pixels(summary, options.chroma_threshold)
+                                                                  : std::nullopt};
+    if (!colored)
+        return std::nullopt;
+    counts.colored_pixel_count = *colored;
+    return counts;
+}
+
+// The --cache entries a run needs: one per --thresholds table, otherwise one for -t or -m.
+std::vector<result_parameters> cache_queries(const processing_options &options)
+{
+    const result_parameters common{.sample_amount = options.sample_amount,
+                                   .jpeg_scale_denom = static_cast<uint8_t>(options.decode.jpeg_scale_denom),
+                                   .classify_yuv = options.classify_yuv};
+    std::vector<result_parameters> queries;
+    if (options.report_max_chroma) {
+        queries.push_back(common);
+        queries.back().mode = result_mode::MAX_CHROMA;
+    } else if (!options.sweep_tables.empty()) {
+        for (const sweep_table &table : options.sweep_tables) {
+            queries.push_back(common);
+            queries.back().chroma_threshold = table.threshold;
+            queries.back().mode = table.exact_bits ? result_mode::EXACT : result_mode::LUT;
+            if (!table.exact_bits)
+                queries.back().lut_resolution = static_cast<uint8_t>(table.lut.index());
+        }
+    } else {
+        queries.push_back(common);
+        queries.back().chroma_threshold = options.chroma_threshold;
+        queries.back().mode = options.exact_chroma_bits ? result_mode::EXACT : result_mode::LUT;
+        if (!options.exact_chroma_bits)
+            queries.back().lut_resolution = static_cast<uint8_t>(options.chroma_check_lut.index());
+    }
+    return queries;
+}
+
+// Answers the run's question from --cache, or returns std::nullopt unless every entry it needs is there.
+std::optional<image_counts> counts_from_cache(const std::string &filename, const file_identity &identity,
+                                              const processing_options &options)
+{
+    image_counts counts;
+    for (const result_parameters &query : cache_queries(options)) {
+        const std::optional<cached_result> cached{options.cache->find(filename, identity, query)};
+        if (!cached)
+            return std::nullopt;
+        counts.total_pixels = cached->total_pixels;
+        counts.sample_count = cached->sample_count;
+        counts.colored_pixel_count = cached->colored_pixel_count;
+        counts.max_chroma_squared = cached->max_chroma_squared;
+        if (!options.sweep_tables.empty())
+            counts.sweep_counts.push_back(cached->colored_pixel_count);
+    }
+    counts.skipped_pixels = counts.total_pixels; // WHY? No pixel was scanned in this run (--stats).
+    return counts;
+}
+
+// Stores what a scan counted in --cache, one entry per query.
+void record_in_cache(const std::string &filename, const file_identity &identity, const processing_options &options,
+                     const image_counts &counts)
+{
+    const std::vector<result_parameters> queries{cache_queries(options)};
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const cached_result result{.total_pixels = counts.total_pixels,
+                                   .sample_count = counts.sample_count,
+                                   .colored_pixel_count =
+                                       counts.sweep_counts.empty() ? counts.colored_pixel_count : counts.sweep_counts[i],
+                                   .max_chroma_squared = counts.max_chroma_squared};
+        options.cache->add(filename, identity, queries[i], result);
+    }
+}
+
+} // namespace
+
+stored_result look_up_stored_result(const std::string &filename, const processing_options &options)
+{
+    // WHY stat first? A stored result only stands for the file as it was; a changed file is decoded again.
+    stored_result stored;
+    if (options.cache || options.index)
+        stored.identity = stat_file_identity(filename);
+    if (stored.identity && options.cache)
+        stored.counts = counts_from_cache(filename, *stored.identity, options);
+    if (stored.identity && options.index && !stored.counts) {
+        const chroma_summary *const summary{options.index->find(filename, *stored.identity)};
+        if (summary)
+            stored.counts = counts_from_summary(*summary, options);
+    }
+    return stored;
+}
+
+// Processes a single image file to determine color ratio or max chroma.
+void process_image_file(const std::string &filename, const processing_options &options, processing_result &result_entry,
+                        const std::span<const uint8_t> file_bytes, std::optional<stored_result> stored)
+{
+    int image_width{0};
+    int image_height{0};
+
+    // Prepare output stream for results or errors.
+    std::stringstream output_stream;
+
+    // --- Answer From The Cache Or Index ---
+    if (!stored)
+        stored = look_up_stored_result(filename, options);
+    const std::optional<file_identity> identity{stored->identity};
+    std::optional<image_counts> counts{std::move(stored->counts)};
+
+    if (!counts) {
+        // --- Read File ---
+        // WHY open it here? Streaming a large image is tried first and a whole decode is the fallback;
+        // both need the same bytes.
+        input_file file;
+        std::span<const uint8_t> image_bytes{file_bytes};
+        if (image_bytes.empty() && open_input_file(filename, file))
+            image_bytes = file.bytes;
+
+        // --- Stream Large Images ---
+        // WHY? A whole decode of a very large image needs its full RGB buffer; streamed bands are
+        // classified while still in cache, and -g/-l or --sample can stop the decoder early.
+        std::optional<image_scan> scan;
+        band_status streamed{band_status::UNSUPPORTED};
+        if (!image_bytes.empty()) {
+            streamed = decode_image_bands(
+                filename, image_bytes, image_width, image_height, options.decode, options.classify_yuv,
+                [&](const uint8_t *rgb_rows, const size_t first_row, const size_t row_count) {
+                    const size_t width{static_cast<size_t>(image_width)};
+                    if (!scan)
+                        scan.emplace(filename, width * image_height, options);
+                    const pixel_source band{.rgb_pixels = rgb_rows, .width = width, .origin = first_row * width};
+                    return scan->scan(band, first_row * width, row_count * width);
+                });
         }
 
-        // --- Max Chroma Tracking (if needed) ---
-        // WHY compute chroma separately? Only needed if max chroma output is requested.
-        if (report_max_chroma) {
-            // WHY squared? Avoids sqrt until the very end for performance.
-            const float current_chroma_squared = compute_chroma_squared(r, g, b);
-            // WHY compare squared? Faster than comparing sqrt(value).
-            if (current_chroma_squared > max_chroma_squared) {
-                max_chroma_squared = current_chroma_squared;
+        // --- Decode Image ---
+        // WHY unique_ptr (smart_pixels_ptr)? Manages pixel buffer lifetime automatically (RAII).
+        // WHY offer YUV planes? Ratio mode can classify AVIF planes directly.
+        yuv_planes yuv;
+        smart_pixels_ptr pixels;
+        if (streamed == band_status::UNSUPPORTED && !image_bytes.empty()) {
+            pixels = decode_image(filename, image_bytes, image_width, image_height, options.decode,
+                                  options.classify_yuv ? &yuv : nullptr);
+        }
+        if (pixels) {
+            pixel_source source{.rgb_pixels = pixels.get(), .width = static_cast<size_t>(image_width)};
+            if (yuv.y_plane) {
+                source.rgb_pixels = nullptr;
+                source.yuv = &yuv;
+                // WHY look up per image? Each AVIF may use a different matrix or range; the table is built
+                // once per combination and cached.
+                source.yuv_bits =
+                    &get_yuv_chroma_bitset(options.chroma_threshold, options.exact_chroma_bits != nullptr,
+                                           lut_blocks(options.chroma_check_lut), yuv.conversion);
             }
+            const size_t total_pixels{static_cast<size_t>(image_width) * image_height};
+            scan.emplace(filename, total_pixels, options);
+            scan->scan(source, 0, total_pixels);
         }
+
+        // WHY check scan? Decoding can fail; handle gracefully.
+        if (!scan || streamed == band_status::FAILED) {
+            output_stream << "ERROR decoding " << filename << "\n";
+            result_entry.output = output_stream.str();
+            // WHY atomic store? Signal main thread that this result is ready (with error).
+            // std::memory_order_release ensures preceding writes (like output string) are visible
+            // to the acquiring thread.
+            result_entry.is_ready.store(true, std::memory_order_release);
+            // WHY notify? Wakes the printer if it is blocked in is_ready.wait() on this slot.
+            result_entry.is_ready.notify_all();
+            return;
+        }
+
+        scan->finish();
+        counts = counts_from_scan(*scan);
+        if (scan->summarizing && scan->summarized_pixels == scan->total_pixels && identity) {
+            scan->summary.width = static_cast<uint32_t>(image_width);
+            scan->summary.height = static_cast<uint32_t>(image_height);
+            options.index->add(filename, *identity, scan->summary);
+        }
+        if (options.cache && identity)
+            record_in_cache(filename, *identity, options, *counts);
     }
 
+    // --- Analyze Pixels ---
+    const size_t total_pixels{counts->total_pixels};
+    const size_t sample_count{counts->sample_count};
+    // WHY the first table? A sweep sorts and reports its first ratio like a single -t run would.
+    const size_t colored_pixel_count{counts->sweep_counts.empty() ? counts->colored_pixel_count : counts->sweep_counts.front()};
+    // 95% confidence interval of the color ratio (--sample only); the ratio estimate is inside it.
+    std::optional<std::pair<float, float>> ratio_interval{std::nullopt};
+    if (sample_count < total_pixels)
+        ratio_interval = wilson_interval(colored_pixel_count, sample_count);
+    result_entry.pixel_count = total_pixels;
+    result_entry.skipped_pixels = counts->skipped_pixels;
+
     // --- Format Output ---
     // WHY check total_pixels? Avoid division by zero for empty/invalid images.
     // const float color_ratio{
@@ -81,20 +725,36 @@ void process_image_file(const std::string &filename, bool file_names_only, bool
     // WHY sqrt here? Only calculate the actual max chroma value once at the end if needed.
     // const float max_chroma{report_max_chroma ? std::sqrt(max_chroma_squared) : 0.f};
 
-    const float report_value{report_max_chroma
-                                 ? std::sqrt(max_chroma_squared)
-                                 : (total_pixels ? static_cast<float>(colored_pixel_count) / total_pixels * 100.0f : 0.f)};
+    const float report_value{options.report_max_chroma ? std::sqrt(counts->max_chroma_squared)
+                                                       : color_ratio(colored_pixel_count, sample_count)};
     result_entry.value = report_value;
 
+    // WHY an interval for a full scan too? With --sample every line has the same columns, even for
+    // images smaller than the budget; their interval is just the exact value.
+    if (options.sample_amount > 0.f && !options.report_max_chroma && !ratio_interval)
+        ratio_interval = std::pair{report_value, report_value};
+
+    // WHY three outcomes? A sampled ratio whose interval straddles -g/-l cannot be decided either way;
+    // such files are printed and marked "undecided" rather than silently kept or dropped.
+    const filter_outcome outcome{ratio_interval ? range_outcome(ratio_interval->first, ratio_interval->second, options)
+                                 : passes_filter(report_value, options) ? filter_outcome::ACCEPT
+                                                                        : filter_outcome::REJECT};
+
     // Print output only if
-    if ((!greater_than || report_value > *greater_than) && (!less_than || report_value < *less_than)) {
-        if (print_filename || file_names_only)
+    if (outcome != filter_outcome::REJECT) {
+        if (options.print_filename || options.file_names_only)
             output_stream << filename;
-        if (!file_names_only) {
-            if (print_filename || file_names_only)
+        if (!options.file_names_only) {
+            if (options.print_filename || options.file_names_only)
                 output_stream << " ";
             output_stream << std::format("{:.3f}", report_value);
+            for (size_t i = 1; i < counts->sweep_counts.size(); ++i)
+                output_stream << std::format(" {:.3f}", color_ratio(counts->sweep_counts[i], total_pixels));
+            if (ratio_interval)
+                output_stream << std::format(" [{:.3f}, {:.3f}]", ratio_interval->first, ratio_interval->second);
         }
+        if (outcome == filter_outcome::UNDECIDED)
+            output_stream << " undecided";
         output_stream << "\n"; // Ensure newline termination.
     }
 
@@ -102,4 +762,23 @@ void process_image_file(const std::string &filename, bool file_names_only, bool
     result_entry.output = output_stream.str();
     // WHY atomic store? Signal main thread that this result is ready (successfully).
     result_entry.is_ready.store(true, std::memory_order_release);
+    result_entry.is_ready.notify_all();
+}
+
+void completion_channel::push(const std::size_t result_index)
+{
+    {
+        std::lock_guard lock{mutex};
+        finished.push_back(result_index);
+    }
+    ready.notify_one();
+}
+
+std::size_t completion_channel::pop()
+{
+    std::unique_lock lock{mutex};
+    ready.wait(lock, [this] { return !finished.empty(); });
+    const std::size_t result_index{finished.front()};
+    finished.pop_front();
+    return result_index;
 }
@@ -1,21 +1,120 @@
 #pragma once
 #include <atomic> // WHY: For atomic<bool> flag for thread synchronization.
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
-#include "lut.hh" // Includes definition of chroma_lut_t
+#include "chroma_index.hh" // For the --index summaries
+#include "decode.hh"       // Includes definition of decode_options
+#include "lut.hh"          // Includes definition of chroma_lut_ref
+#include "result_cache.hh" // For the --cache results
+#include "worker_pool.hh"  // For splitting large images across workers
 
 // Holds the formatted output string and a ready flag for a single image processing task.
 struct processing_result {
     std::string output; // Pre-formatted output string (result or error).
     float value{0.f};   // Numeric value used for sorting
+    std::size_t pixel_count{0};    // Pixels in the decoded image (for --stats).
+    std::size_t skipped_pixels{0}; // Pixels left unscanned (-g/-l already settled, or --sample).
     // WHY atomic? Ensures safe communication of ready status between threads without explicit locks.
+    // Readers block with is_ready.wait(false); the worker notifies after storing true.
     std::atomic<bool> is_ready{false};
 };
 
+// Hands indices of finished results to a consumer in completion order (for --unordered output).
+// WHY mutex + condition variable? The consumer sleeps until a result lands instead of polling.
+class completion_channel {
+  public:
+    // Called by a worker after its result slot is ready.
+    void push(std::size_t result_index);
+
+    // Blocks until some result is finished and returns its index.
+    std::size_t pop();
+
+  private:
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<std::size_t> finished;
+};
+
+// One threshold of a --thresholds sweep: its block LUT, or its exact bitset with --exact.
+struct sweep_table {
+    float threshold{0.f};
+    chroma_lut_ref lut{};
+    const chroma_bitset_t *exact_bits{nullptr};
+};
+
+// Settings shared by every image of a run.
+// WHY a struct? Keeps the per-file call short as options grow; one instance is shared
+// read-only by all workers.
+struct processing_options {
+    bool file_names_only{false};   // Output only file names.
+    bool report_max_chroma{false}; // Output max chroma instead of the color ratio.
+    std::optional<float> greater_than{std::nullopt};
+    std::optional<float> less_than{std::nullopt};
+    bool print_filename{false}; // Prefix values with the file name.
+    // WHY track this? When only file names are printed and nothing is sorted, a file that is
+    // certain to pass -g/-l can stop scanning; otherwise its exact ratio is still needed.
+    bool value_needed{true};
+    // --sample: 0 scans every pixel; below 1 it is the fraction of pixels to classify, otherwise
+    // the number of pixels per image.
+    float sample_amount{0.f};
+    decode_options decode; // Passed to decode_image() (e.g. --scale).
+
+    float chroma_threshold{5.f}; // WHY keep it? YUV tables are fetched per AVIF matrix while processing.
+    // Classify AVIF and lossy WebP files from their YUV planes (see get_yuv_chroma_bitset()).
+    bool classify_yuv{false};
+    // WHY pointers? The tables are large and shared; they are owned by lut.cc's caches.
+    chroma_lut_ref chroma_check_lut{}; // Block LUT (default classifier), 64x64 unless --lut-blocks.
+    // When set, pixels are classified with this exact per-RGB table instead of the block LUT.
+    const chroma_bitset_t *exact_chroma_bits{nullptr};
+    // --thresholds: each image is classified against every table in one pass and reported as one
+    // ratio per table, in order. Empty for a single -t. Pixels are always RGB (classify_yuv off),
+    // and chroma_check_lut and exact_chroma_bits are left unset.
+    std::vector<sweep_table> sweep_tables;
+
+    // Images of at least this many pixels have their classification split into ranges that idle
+    // workers of `pool` help with (0 or no pool = one worker per image).
+    std::size_t split_pixels{0};
+    worker_pool *pool{nullptr};
+
+    // --index: answers --exact and -m queries from stored chroma histograms and records a histogram
+    // for every image it has to decode (null = no index). Pixels are always RGB (classify_yuv off).
+    chroma_index *index{nullptr};
+    // --cache: answers from stored results of earlier runs with the same settings and records every
+    // result it has to compute (null = no cache). Turns off the -g/-l early exit, which would leave
+    // counts incomplete.
+    result_cache *cache{nullptr};
+};
+
+// What classifying an image produced, whether by scanning it or from its --index summary.
+struct image_counts {
+    std::size_t total_pixels{0};
+    std::size_t sample_count{0}; // Pixels the ratio is taken over; total_pixels unless --sample.
+    std::size_t colored_pixel_count{0};
+    float max_chroma_squared{0.f};
+    std::vector<std::size_t> sweep_counts; // --thresholds: colored pixels per table.
+    std::size_t skipped_pixels{0};
+};
+
+// What --cache and --index hold for one file.
+struct stored_result {
+    std::optional<file_identity> identity; // Unset without --cache and --index, or when the stat failed.
+    std::optional<image_counts> counts;    // Set when the file is answered without decoding.
+};
+
+// Looks `filename` up in --cache, then in --index. Costs one stat when either is open, nothing otherwise.
+stored_result look_up_stored_result(const std::string &filename, const processing_options &options);
+
 // Function signature for processing a single image file.
-// Takes parameters controlling output format and the precomputed LUT.
 // Modifies the passed processing_result struct.
-void process_image_file(const std::string &filename, bool file_names_only, bool report_max_chroma,
-                        std::optional<float> greater_than, std::optional<float> less_than, bool print_filename,
-                        processing_result &result_entry, const chroma_lut_t &chroma_check_lut);
+// `file_bytes` holds the file's contents when the read-ahead stage already read it; when empty,
+// the file is opened here. `stored` is the file's look_up_stored_result() when the caller already
+// made it; otherwise the lookup happens here.
+void process_image_file(const std::string &filename, const processing_options &options, processing_result &result_entry,
+                        std::span<const uint8_t> file_bytes = {}, std::optional<stored_result> stored = std::nullopt);
@@ -0,0 +1,262 @@
+#include "read_ahead.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>    // For open
+#include <sys/stat.h> // For stat, statx
+#include <unistd.h>   // For pread, close
+
+#ifdef CPIX_IO_URING
+#include <cstring>  // For strerror
+#include <iostream> // For std::cerr
+
+#include <liburing.h>
+#endif
+
+namespace {
+
+// Reads a whole regular file with blocking calls. Returns an empty file when it cannot.
+prefetched_file read_whole_file(const std::string &filename)
+{
+    prefetched_file file;
+    // WHY stat before open? Opening a FIFO blocks for a writer and then takes its data away from the
+    // worker that will read it; only regular files are read ahead.
+    struct stat file_status;
+    if (stat(filename.c_str(), &file_status) != 0 || !S_ISREG(file_status.st_mode) || file_status.st_size <= 0)
+        return file;
+    const int fd{open(filename.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0)
+        return file;
+
+    const std::size_t size{static_cast<std::size_t>(file_status.st_size)};
+    // WHY for_overwrite? Every byte is about to be read into; zeroing megabytes first is wasted work.
+    file.data = std::make_unique_for_overwrite<uint8_t[]>(size);
+    while (file.size < size) {
+        const ssize_t got{pread(fd, file.data.get() + file.size, size - file.size, static_cast<off_t>(file.size))};
+        if (got < 0 && errno == EINTR)
+            continue;
+        // WHY keep a short read? The file shrank while being read; decode what is there, as
+        // reading it any other way would.
+        if (got == 0)
+            break;
+        if (got < 0) {
+            file = {};
+            break;
+        }
+        file.size += static_cast<std::size_t>(got);
+    }
+    close(fd);
+    return file;
+}
+
+} // namespace
+
+read_ahead::read_ahead(const std::vector<std::string> &filenames, const std::size_t queue_depth, const std::size_t buffer_limit)
+    : filenames{filenames}, queue_depth{std::max<std::size_t>(queue_depth, 1)},
+      // WHY at least the queue depth? Otherwise some of the requested reads could never start.
+      buffer_permits{static_cast<std::ptrdiff_t>(std::max(buffer_limit, this->queue_depth))}
+{
+}
+
+void read_ahead::run(delivery deliver, read_filter wanted)
+{
+#ifdef CPIX_IO_URING
+    if (run_io_uring(deliver, wanted))
+        return;
+#endif
+    run_threads(deliver, wanted);
+}
+
+void read_ahead::release() { buffer_permits.release(); }
+
+void read_ahead::run_threads(delivery &deliver, read_filter &wanted)
+{
+    // WHY min with file count? Never start more readers than there are files to read.
+    const std::size_t reader_count{std::min(queue_depth, filenames.size())};
+    std::atomic<std::size_t> next_file{0};
+
+    std::vector<std::jthread> readers;
+    readers.reserve(reader_count);
+    for (std::size_t r = 0; r < reader_count; ++r) {
+        readers.emplace_back([&] {
+            while (true) {
+                // WHY take the permit before the index? Files are then claimed in input order by
+                // whichever reader is allowed to read next.
+                buffer_permits.acquire();
+                const std::size_t file_index{next_file.fetch_add(1, std::memory_order_relaxed)};
+                if (file_index >= filenames.size()) {
+                    buffer_permits.release();
+                    return;
+                }
+                deliver(file_index, !wanted || wanted(file_index) ? read_whole_file(filenames[file_index]) : prefetched_file{});
+            }
+        });
+    }
+    // The jthreads join here, after the last file has been delivered.
+}
+
+#ifdef CPIX_IO_URING
+namespace {
+
+// Where a file is in its chain of ring operations.
+enum class ring_stage { STAT, OPEN, READ };
+
+// One file moving through the ring: statx, then openat, then reads until it is complete.
+// Each slot has at most one operation in flight, so `queue_depth` slots never overflow the ring.
+struct ring_slot {
+    ring_stage stage{ring_stage::STAT};
+    std::size_t file_index{0};
+    int fd{-1};
+    struct statx status{};
+    prefetched_file file;
+    std::size_t expected_size{0};
+};
+
+// WHY cap a single read? The length of an io_uring read is 32 bits wide.
+constexpr std::size_t max_ring_read{std::size_t{1} << 30};
+
+void queue_read(io_uring &ring, ring_slot &slot)
+{
+    io_uring_sqe *const sqe{io_uring_get_sqe(&ring)};
+    const std::size_t remaining{std::min(slot.expected_size - slot.file.size, max_ring_read)};
+    io_uring_prep_read(sqe, slot.fd, slot.file.data.get() + slot.file.size, static_cast<unsigned>(remaining), slot.file.size);
+    io_uring_sqe_set_data(sqe, &slot);
+}
+
+} // namespace
+
+// Returns false, before delivering anything, when no ring can be created.
+// WHY no registered buffers? Each buffer is sized to its file and handed to a worker, which keeps
+// it until decoding ends; a fixed set of registered buffers would need a copy out of the ring
+// per file, costing more than the page pinning it saves at image sizes.
+bool read_ahead::run_io_uring(delivery &deliver, read_filter &wanted)
+{
+    io_uring ring;
+    const int setup_error{io_uring_queue_init(static_cast<unsigned>(queue_depth), &ring, 0)};
+    // WHY fall back? Older kernels and some container sandboxes refuse io_uring_setup().
+    if (setup_error < 0) {
+        std::cerr << "INFO: io_uring unavailable (" << std::strerror(-setup_error) << "), reading ahead with threads\n";
+        return false;
+    }
+    // WHY unique_ptr with lambda deleter? Tears the ring down on every return path (RAII).
+    const auto exit_ring = [](io_uring *r) { io_uring_queue_exit(r); };
+    std::unique_ptr<io_uring, decltype(exit_ring)> ring_guard(&ring, exit_ring);
+
+    std::vector<ring_slot> slots(queue_depth);
+    std::vector<ring_slot *> free_slots;
+    for (auto &slot : slots)
+        free_slots.push_back(&slot);
+    std::size_t next_file{0};
+
+    // Hands a file to the consumer and frees its slot. An incomplete file is delivered empty.
+    const auto finish = [&](ring_slot &slot, const bool complete) {
+        if (slot.fd >= 0)
+            close(slot.fd);
+        if (!complete)
+            slot.file = {};
+        deliver(slot.file_index, std::move(slot.file));
+        slot = {};
+        free_slots.push_back(&slot);
+    };
+
+    while (next_file < filenames.size() || free_slots.size() < slots.size()) {
+        // --- Start new files while slots and buffer permits last ---
+        while (next_file < filenames.size() && !free_slots.empty()) {
+            // WHY only block with an empty ring? Completions must still be reaped while the
+            // workers catch up, or reads that already finished would wait for no reason.
+            if (free_slots.size() == slots.size())
+                buffer_permits.acquire();
+            else if (!buffer_permits.try_acquire())
+                break;
+            // WHY filter on the ring thread? The reads already queued go on meanwhile; a skipped
+            // file only costs the check.
+            if (wanted && !wanted(next_file)) {
+                deliver(next_file++, {});
+                continue;
+            }
+            ring_slot &slot{*free_slots.back()};
+            free_slots.pop_back();
+            slot.file_index = next_file++;
+            io_uring_sqe *const sqe{io_uring_get_sqe(&ring)};
+            io_uring_prep_statx(sqe, AT_FDCWD, filenames[slot.file_index].c_str(), 0, STATX_TYPE | STATX_SIZE, &slot.status);
+            io_uring_sqe_set_data(sqe, &slot);
+        }
+        io_uring_submit(&ring);
+
+        // --- Advance every file whose operation completed ---
+        io_uring_cqe *cqe{nullptr};
+        const int wait_error{io_uring_wait_cqe(&ring, &cqe)};
+        if (wait_error == -EINTR)
+            continue;
+        if (wait_error < 0) {
+            std::cerr << "ERROR: io_uring wait failed (" << std::strerror(-wait_error) << "), workers read the remaining files\n";
+            break;
+        }
+        do {
+            ring_slot &slot{*static_cast<ring_slot *>(io_uring_cqe_get_data(cqe))};
+            const int result{cqe->res};
+            io_uring_cqe_seen(&ring, cqe);
+
+            switch (slot.stage) {
+            case ring_stage::STAT: {
+                // WHY stat before open? Opening a FIFO blocks for a writer and then takes its data
+                // away from the worker that will read it; only regular files are read ahead.
+                if (result < 0 || !S_ISREG(slot.status.stx_mode) || slot.status.stx_size == 0) {
+                    finish(slot, false);
+                    break;
+                }
+                slot.stage = ring_stage::OPEN;
+                io_uring_sqe *const sqe{io_uring_get_sqe(&ring)};
+                io_uring_prep_openat(sqe, AT_FDCWD, filenames[slot.file_index].c_str(), O_RDONLY | O_CLOEXEC, 0);
+                io_uring_sqe_set_data(sqe, &slot);
+                break;
+            }
+            case ring_stage::OPEN:
+                if (result < 0) {
+                    finish(slot, false);
+                    break;
+                }
+                slot.fd = result;
+                slot.expected_size = slot.status.stx_size;
+                slot.file.data = std::make_unique_for_overwrite<uint8_t[]>(slot.expected_size);
+                slot.stage = ring_stage::READ;
+                queue_read(ring, slot);
+                break;
+            case ring_stage::READ:
+                if (result == -EINTR || result == -EAGAIN) {
+                    queue_read(ring, slot);
+                } else if (result < 0) {
+                    finish(slot, false);
+                } else if (result == 0) {
+                    finish(slot, true); // The file shrank while being read; keep what is there.
+                } else {
+                    slot.file.size += static_cast<std::size_t>(result);
+                    if (slot.file.size < slot.expected_size)
+                        queue_read(ring, slot);
+                    else
+                        finish(slot, true);
+                }
+                break;
+            }
+        } while (io_uring_peek_cqe(&ring, &cqe) == 0);
+    }
+
+    // --- Only after a failed wait: hand everything left to the workers ---
+    // WHY exit the ring first? It cancels and waits for the operations in flight, so the kernel no
+    // longer writes into the buffers about to be dropped.
+    ring_guard.reset();
+    for (auto &slot : slots) {
+        if (std::find(free_slots.begin(), free_slots.end(), &slot) == free_slots.end())
+            finish(slot, false);
+    }
+    for (; next_file < filenames.size(); ++next_file) {
+        buffer_permits.acquire();
+        deliver(next_file, {});
+    }
+    return true;
+}
+#endif
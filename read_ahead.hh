@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional> // WHY: For std::move_only_function used as the delivery callback.
+#include <memory>
+#include <semaphore>
+#include <span>
+#include <string>
+#include <vector>
+
+// The contents of one input file, read by the read-ahead stage.
+// Empty when the file could not be read ahead (missing, not a regular file, empty, or an I/O
+// error); the worker then opens it itself, which also reports the error the usual way.
+struct prefetched_file {
+    std::unique_ptr<uint8_t[]> data;
+    std::size_t size{0};
+
+    std::span<const uint8_t> bytes() const { return {data.get(), size}; }
+};
+
+// Reads input files ahead of the workers that decode them, keeping up to `queue_depth` reads in
+// flight. WHY a separate stage? A worker that opens and reads its own file sits idle for the
+// whole read; on network or spinning-disk volumes that is most of its time. Here the reads
+// overlap each other, and a file reaches a worker only once it is in memory.
+//
+// Built with CPIX_IO_URING (make IO_URING=1), one thread drives every read through an io_uring;
+// otherwise, or when the kernel refuses to create a ring, `queue_depth` threads issue blocking reads.
+class read_ahead {
+  public:
+    // Called once per file, in completion order, from the read-ahead thread(s); with I/O threads,
+    // several calls may run at once.
+    using delivery = std::move_only_function<void(std::size_t file_index, prefetched_file file)>;
+    // Called once per file by the reader that claims it, before reading; returning false delivers
+    // the file empty without reading it. With I/O threads, several calls may run at once.
+    using read_filter = std::move_only_function<bool(std::size_t file_index)>;
+
+    // `buffer_limit` caps the files that are read but not yet released (see release()), so
+    // peak memory stays bounded when the disk is faster than the decoders.
+    read_ahead(const std::vector<std::string> &filenames, std::size_t queue_depth, std::size_t buffer_limit);
+
+    read_ahead(const read_ahead &) = delete;
+    read_ahead &operator=(const read_ahead &) = delete;
+
+    // Reads every file that `wanted` accepts (every file when it is empty) and hands it to `deliver`.
+    // Returns once every file has been delivered.
+    // WHY filter here? Per-file checks (such as a --cache lookup) then run on the reader threads, in
+    // parallel with the reads, instead of serially before the first read starts.
+    void run(delivery deliver, read_filter wanted = {});
+
+    // Tells the stage that a delivered file's buffer is gone, so another file may be read.
+    // Call exactly once per delivered file, after dropping its prefetched_file.
+    void release();
+
+  private:
+    void run_threads(delivery &deliver, read_filter &wanted);
+#ifdef CPIX_IO_URING
+    bool run_io_uring(delivery &deliver, read_filter &wanted);
+#endif
+
+    const std::vector<std::string> &filenames;
+    std::size_t queue_depth;
+    // WHY a semaphore? Each file takes a permit before its read starts and gives it back in
+    // release(); readers block when `buffer_limit` files are waiting for or inside a worker.
+    std::counting_semaphore<> buffer_permits;
+};
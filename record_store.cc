@@ -0,0 +1,171 @@
+#include "record_store.hh"
+
+#include <cerrno>
+#include <cstring> // For memcmp, memcpy, strerror
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>    // For open
+#include <sys/file.h> // For flock
+#include <sys/mman.h> // For mmap, munmap
+#include <sys/stat.h> // For fstat, stat
+#include <unistd.h>   // For write, pread, ftruncate, close
+
+namespace {
+
+// Start of every store. WHY record_bytes? A build with a different layout refuses the file
+// instead of misreading it.
+struct store_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_bytes;
+};
+
+// Holds flock(fd, LOCK_EX or LOCK_SH) until destroyed. Check locked() after constructing.
+// WHY flock? Other cpix processes may open and append to the same store at the same time; the
+// lock follows the open file, so it goes away with a process that dies holding it.
+class file_lock {
+  public:
+    file_lock(const int fd, const int operation) : fd{fd}
+    {
+        int result;
+        while ((result = flock(fd, operation)) != 0 && errno == EINTR) {
+        }
+        held = result == 0;
+    }
+    ~file_lock()
+    {
+        if (held)
+            flock(fd, LOCK_UN);
+    }
+    file_lock(const file_lock &) = delete;
+    file_lock &operator=(const file_lock &) = delete;
+
+    bool locked() const { return held; }
+
+  private:
+    int fd;
+    bool held{false};
+};
+
+} // namespace
+
+std::optional<file_identity> stat_file_identity(const std::string &filename)
+{
+    struct stat file_status;
+    if (stat(filename.c_str(), &file_status) != 0 || !S_ISREG(file_status.st_mode))
+        return std::nullopt;
+    return file_identity{static_cast<uint64_t>(file_status.st_size),
+                         static_cast<int64_t>(file_status.st_mtim.tv_sec) * 1'000'000'000 + file_status.st_mtim.tv_nsec,
+                         static_cast<uint64_t>(file_status.st_ino)};
+}
+
+uint64_t hash_bytes(const std::span<const uint8_t> bytes, uint64_t hash)
+{
+    for (const uint8_t byte : bytes) {
+        hash = (hash ^ byte) * 0x100000001b3;
+    }
+    return hash;
+}
+
+uint64_t file_path_key(const std::string &filename)
+{
+    std::error_code error;
+    const std::filesystem::path path{std::filesystem::absolute(filename, error)};
+    const std::string key{error ? filename : path.lexically_normal().native()};
+    return hash_bytes({reinterpret_cast<const uint8_t *>(key.data()), key.size()});
+}
+
+record_store::~record_store()
+{
+    if (mapping)
+        munmap(mapping, mapping_size);
+    if (fd >= 0)
+        close(fd);
+}
+
+bool record_store::open(const std::string &path, const char (&magic)[8], const uint32_t version, const uint32_t record_bytes)
+{
+    this->path = path;
+    this->record_bytes = record_bytes;
+    // WHY O_APPEND? Records from concurrent workers (or cpix processes) never overwrite each other.
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "ERROR: Cannot open " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    // WHY exclusive until open() returns? Two processes creating the store at once would both see
+    // it empty and append a header each, and a repair could cut off a record another process is
+    // appending (append() holds the lock shared). WHY not keep a lock for the run? An exclusive
+    // opener would then wait for every other run to finish.
+    const file_lock lock{fd, LOCK_EX};
+    if (!lock.locked()) {
+        std::cerr << "ERROR: Cannot lock " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+
+    struct stat file_status;
+    if (fstat(fd, &file_status) != 0) {
+        std::cerr << "ERROR: Cannot stat " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    const std::size_t file_size{static_cast<std::size_t>(file_status.st_size)};
+    store_header header{};
+    std::memcpy(header.magic, magic, sizeof(header.magic));
+    header.version = version;
+    header.record_bytes = record_bytes;
+
+    if (file_size == 0) {
+        if (write(fd, &header, sizeof(header)) != static_cast<ssize_t>(sizeof(header))) {
+            std::cerr << "ERROR: Cannot write " << path << ": " << std::strerror(errno) << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    store_header stored{};
+    if (file_size < sizeof(stored) || pread(fd, &stored, sizeof(stored), 0) != static_cast<ssize_t>(sizeof(stored)) ||
+        std::memcmp(&stored, &header, sizeof(header)) != 0) {
+        std::cerr << "ERROR: " << path << " has an unknown format or version\n";
+        return false;
+    }
+
+    const std::size_t record_count{(file_size - sizeof(header)) / record_bytes};
+    const std::size_t used_size{sizeof(header) + record_count * record_bytes};
+    // WHY truncate? A run that died mid-append leaves a partial record; appending after it would
+    // shift every later record.
+    if (used_size != file_size && ftruncate(fd, static_cast<off_t>(used_size)) != 0) {
+        std::cerr << "ERROR: Cannot repair " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    if (record_count == 0)
+        return true;
+
+    mapping = mmap(nullptr, used_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        std::cerr << "ERROR: Cannot map " << path << ": " << std::strerror(errno) << "\n";
+        return false;
+    }
+    mapping_size = used_size;
+    mapped_records = static_cast<const uint8_t *>(mapping) + sizeof(header);
+    mapped_count = record_count;
+    return true;
+}
+
+void record_store::append(const void *record)
+{
+    std::lock_guard lock{append_mutex};
+    // WHY stop after a failure? A partial record would shift every record appended after it.
+    if (append_failed)
+        return;
+    // WHY one write()? With O_APPEND the record lands whole after whatever other processes appended.
+    // WHY the shared lock? It keeps another process's open() from repairing the file mid-write.
+    const file_lock shared_lock{fd, LOCK_SH};
+    const ssize_t written{shared_lock.locked() ? write(fd, record, record_bytes) : -1};
+    if (written != static_cast<ssize_t>(record_bytes)) {
+        append_failed = true;
+        std::cerr << "ERROR: Cannot append to " << path << ": " << (written < 0 ? std::strerror(errno) : "short write") << "\n";
+    }
+}
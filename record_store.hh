@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+
+// Stat identity of an input file. A stored record is only used while the file still matches it.
+struct file_identity {
+    uint64_t size{0};
+    int64_t mtime_ns{0};
+    uint64_t inode{0};
+
+    bool operator==(const file_identity &) const = default;
+};
+
+// Returns std::nullopt when `filename` cannot be stat'ed or is not a regular file (e.g. a pipe).
+std::optional<file_identity> stat_file_identity(const std::string &filename);
+
+// Key of an input file in a record_store: a hash of its absolute path, so the same file named
+// from two working directories finds one record.
+uint64_t file_path_key(const std::string &filename);
+
+// FNV-1a over `bytes`, continuing from `hash`. WHY not std::hash? Keys are stored on disk, so
+// they must not change between builds.
+uint64_t hash_bytes(std::span<const uint8_t> bytes, uint64_t hash = 0xcbf29ce484222325);
+
+// An append-only file of fixed-size records behind a short header, shared by --index and --cache.
+// WHY append-only? Workers add records while others read; appending never moves the records
+// already mapped, and a crash loses at most the record being written. A changed file gets a new
+// record; readers let the last record for a key win.
+//
+// Records are stored in native byte order: the file is a cache for one machine, not an exchange
+// format. They must have no padding, or uninitialized bytes would be written.
+class record_store {
+  public:
+    record_store() = default;
+    ~record_store();
+
+    record_store(const record_store &) = delete;
+    record_store &operator=(const record_store &) = delete;
+
+    // Opens `path`, creating it when missing, and maps the records it already holds. Returns false
+    // (after printing an error) when it cannot be opened or holds another `magic`, `version` or
+    // record size.
+    bool open(const std::string &path, const char (&magic)[8], uint32_t version, uint32_t record_bytes);
+
+    // The records that existed when the store was opened. Records added since are not mapped.
+    template <typename Record>
+    std::span<const Record> records() const
+    {
+        return {reinterpret_cast<const Record *>(mapped_records), mapped_count};
+    }
+
+    // Appends one record of the size given to open(). Safe to call from any thread.
+    void append(const void *record);
+
+  private:
+    std::string path; // For error messages.
+    int fd{-1};
+    void *mapping{nullptr};
+    std::size_t mapping_size{0};
+    const uint8_t *mapped_records{nullptr};
+    std::size_t mapped_count{0};
+    std::size_t record_bytes{0};
+    std::mutex append_mutex;
+    bool append_failed{false}; // Set after a failed write; later records are dropped.
+};
@@ -0,0 +1,56 @@
+#include "result_cache.hh"
+
+// One result as stored in the cache file. WHY this order? No field needs padding, so no
+// uninitialized bytes reach the file.
+struct result_cache::record {
+    uint64_t path_hash;
+    file_identity identity;
+    cached_result result;
+    result_parameters parameters;
+    uint32_t reserved;
+};
+
+namespace {
+
+constexpr char cache_magic[8]{'C', 'P', 'I', 'X', 'R', 'S', 'L', 'T'};
+constexpr uint32_t cache_version{2}; // 2: chroma from the correctly rounded cube root, regenerated preset LUTs.
+
+// Map key of a file's result with the given parameters.
+uint64_t result_key(const uint64_t path_hash, const result_parameters &parameters)
+{
+    return hash_bytes({reinterpret_cast<const uint8_t *>(&parameters), sizeof(parameters)}, path_hash);
+}
+
+} // namespace
+
+bool result_cache::open(const std::string &path)
+{
+    if (!store.open(path, cache_magic, cache_version, sizeof(record)))
+        return false;
+    const std::span<const record> stored{store.records<record>()};
+    records.reserve(stored.size());
+    for (const record &entry : stored) {
+        // Later records supersede earlier ones.
+        records.insert_or_assign(result_key(entry.path_hash, entry.parameters), &entry);
+    }
+    return true;
+}
+
+std::optional<cached_result> result_cache::find(const std::string &filename, const file_identity &identity,
+                                                const result_parameters &parameters) const
+{
+    const uint64_t path_hash{file_path_key(filename)};
+    const auto found{records.find(result_key(path_hash, parameters))};
+    // WHY compare the parameters too? Two keys may collide; the stored fields decide.
+    if (found == records.end() || found->second->path_hash != path_hash || found->second->identity != identity ||
+        found->second->parameters != parameters)
+        return std::nullopt;
+    return found->second->result;
+}
+
+void result_cache::add(const std::string &filename, const file_identity &identity, const result_parameters &parameters,
+                       const cached_result &result)
+{
+    const record entry{file_path_key(filename), identity, result, parameters, 0};
+    store.append(&entry);
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+#include "record_store.hh" // For the cache file and file_identity
+
+// How a cached count was classified.
+enum class result_mode : uint8_t { LUT, EXACT, MAX_CHROMA };
+
+// The settings a result depends on besides the file itself. Two runs that agree on all of them
+// classify the same pixels the same way.
+struct result_parameters {
+    float chroma_threshold{0.f}; // 0 with MAX_CHROMA, which uses no threshold.
+    float sample_amount{0.f};    // --sample, 0 for every pixel.
+    result_mode mode{result_mode::LUT};
+    uint8_t jpeg_scale_denom{1};
+    uint8_t classify_yuv{0}; // WHY part of the key? AVIF/WebP YUV and RGB classification may differ by a few pixels.
+    // With LUT: the chroma_lut_ref index of the table (0 = 64x64, 1 = 128x128, 2 = 256x256); finer
+    // tables count more pixels as colored. WHY in the old reserved byte? Records written before
+    // --lut-blocks existed hold 0 there and are 64x64 results, so the file version stays.
+    uint8_t lut_resolution{0};
+
+    bool operator==(const result_parameters &) const = default;
+};
+
+// The counts of one classification, all a cached run needs to print the same line again.
+struct cached_result {
+    uint64_t total_pixels{0};
+    uint64_t sample_count{0};
+    uint64_t colored_pixel_count{0};
+    float max_chroma_squared{0.f};
+    uint32_t reserved{0};
+};
+
+// A record_store of classification results keyed by file and parameters (--cache FILE).
+// WHY one record per threshold? A --thresholds sweep then shares its entries with -t runs at
+// the same thresholds, and records keep a fixed size.
+class result_cache {
+  public:
+    // Maps the cache at `path`, creating it when missing. Returns false (after printing an error)
+    // when it cannot be opened or is not a cache of this version.
+    bool open(const std::string &path);
+
+    // The result stored for `filename` with these parameters, or std::nullopt when there is none
+    // for its current identity. Safe to call from any thread, without locking; only sees records
+    // that existed when the cache was opened.
+    std::optional<cached_result> find(const std::string &filename, const file_identity &identity,
+                                      const result_parameters &parameters) const;
+
+    // Appends a result. Safe to call from any thread.
+    void add(const std::string &filename, const file_identity &identity, const result_parameters &parameters,
+             const cached_result &result);
+
+  private:
+    struct record;
+
+    record_store store;
+    // WHY a plain map? It is filled in open() and only read afterwards, so workers look up
+    // results concurrently with no lock and no contention.
+    std::unordered_map<uint64_t, const record *> records;
+};
@@ -0,0 +1,129 @@
+#include "worker_pool.hh"
+
+#include <algorithm>
+#include <utility>
+
+worker_pool::worker_pool(std::size_t worker_count)
+{
+    // WHY max with 1? A pool without workers would never run anything.
+    worker_count = std::max<std::size_t>(worker_count, 1);
+
+    queues.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; ++i) {
+        queues.push_back(std::make_unique<worker_queue>());
+    }
+
+    // WHY create queues before threads? Workers steal from every queue as soon as they start.
+    threads.reserve(worker_count);
+    for (std::size_t i = 0; i < worker_count; ++i) {
+        threads.emplace_back(&worker_pool::run_worker, this, i);
+    }
+}
+
+worker_pool::~worker_pool()
+{
+    {
+        std::lock_guard lock{sleep_mutex};
+        stopping = true;
+    }
+    work_available.notify_all();
+
+    for (auto &t : threads) {
+        if (t.joinable())
+            t.join();
+    }
+}
+
+std::size_t worker_pool::default_worker_count()
+{
+    // WHY fallback to 1? hardware_concurrency() may return 0 when the value is not computable.
+    const unsigned hw_threads{std::thread::hardware_concurrency()};
+    return hw_threads ? hw_threads : 1;
+}
+
+void worker_pool::submit(task work)
+{
+    {
+        std::lock_guard lock{idle_mutex};
+        ++unfinished;
+    }
+
+    // WHY round-robin? Spreads consecutive files over workers so each deque holds files in
+    // input order, which keeps ordered output flowing while the pool works.
+    const std::size_t target{next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size()};
+    {
+        std::lock_guard lock{queues[target]->mutex};
+        // WHY count under the deque lock? A thief cannot pop this task before it is counted,
+        // so `queued` never drops below the real number of queued tasks.
+        queued.fetch_add(1, std::memory_order_release);
+        queues[target]->tasks.push_back(std::move(work));
+    }
+
+    // WHY lock before notify? A worker checks `queued` under sleep_mutex before sleeping,
+    // so taking the lock here guarantees it either sees the new task or receives the notify.
+    {
+        std::lock_guard lock{sleep_mutex};
+    }
+    work_available.notify_one();
+}
+
+void worker_pool::wait()
+{
+    std::unique_lock lock{idle_mutex};
+    all_idle.wait(lock, [this] { return unfinished == 0; });
+}
+
+bool worker_pool::try_take(std::size_t self, task &out)
+{
+    // Own deque first, from the front: the oldest file assigned to this worker.
+    {
+        auto &own = *queues[self];
+        std::lock_guard lock{own.mutex};
+        if (!own.tasks.empty()) {
+            out = std::move(own.tasks.front());
+            own.tasks.pop_front();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    // Steal from the other deques, from the back.
+    // WHY the back? The owner works from the front, so thieves take the work the owner
+    // would reach last and the two rarely fight over the same end.
+    for (std::size_t offset = 1; offset < queues.size(); ++offset) {
+        auto &victim = *queues[(self + offset) % queues.size()];
+        std::lock_guard lock{victim.mutex};
+        if (!victim.tasks.empty()) {
+            out = std::move(victim.tasks.back());
+            victim.tasks.pop_back();
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void worker_pool::run_worker(std::size_t self)
+{
+    task work;
+    while (true) {
+        if (try_take(self, work)) {
+            work();
+            work = nullptr; // WHY reset? Release captured state before looking for more work.
+
+            std::lock_guard lock{idle_mutex};
+            if (--unfinished == 0) {
+                all_idle.notify_all();
+            }
+            continue;
+        }
+
+        // Nothing to take anywhere: sleep until submit() or the destructor wakes us.
+        std::unique_lock lock{sleep_mutex};
+        work_available.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+        // WHY drain before exiting? The destructor promises that queued tasks still run.
+        if (stopping && queued.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
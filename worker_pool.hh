@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional> // WHY: For std::move_only_function used as the task type.
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size thread pool with one task deque per worker and work stealing.
+// WHY fixed size? One OS thread per input file does not scale: 20k files meant 20k threads,
+// each holding a decoded image at the same time. A bounded pool keeps at most `size()`
+// images in flight, so peak memory no longer grows with the number of files.
+class worker_pool {
+  public:
+    using task = std::move_only_function<void()>;
+
+    // Starts `worker_count` threads (at least one).
+    explicit worker_pool(std::size_t worker_count);
+
+    // Runs every task still queued, then joins all workers.
+    ~worker_pool();
+
+    worker_pool(const worker_pool &) = delete;
+    worker_pool &operator=(const worker_pool &) = delete;
+
+    // Queues a task. Tasks are dealt round-robin over the worker deques.
+    void submit(task work);
+
+    // Blocks until every submitted task has finished running.
+    void wait();
+
+    std::size_t size() const { return threads.size(); }
+
+    // Worker count used when the user does not pass --jobs.
+    static std::size_t default_worker_count();
+
+  private:
+    // WHY a mutex per deque? Owners and thieves touch different deques most of the time,
+    // so contention stays low without the complexity of a lock-free Chase-Lev deque.
+    struct worker_queue {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    void run_worker(std::size_t self);
+    bool try_take(std::size_t self, task &out);
+
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<std::size_t> next_queue{0}; // Round-robin cursor for submit().
+    std::atomic<std::size_t> queued{0};     // Tasks sitting in some deque.
+
+    // WHY a separate mutex for sleeping? Idle workers block here instead of spinning over
+    // the deques; submit() notifies under this mutex so no wake-up is lost.
+    std::mutex sleep_mutex;
+    std::condition_variable work_available;
+    bool stopping{false};
+
+    // Tracks tasks that were submitted but have not finished, for wait().
+    std::mutex idle_mutex;
+    std::condition_variable all_idle;
+    std::size_t unfinished{0};
+};